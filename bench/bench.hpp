@@ -0,0 +1,58 @@
+// Shared by the benchmarks, which each include the lexer itself with main() left out
+#define LEX_NO_MAIN
+#include "../lex.cpp"
+#include "corpus.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+
+
+// Every test program, repeated until there is at least size bytes of source
+string make_corpus (size_t size)
+{
+    string programs;
+
+    for (auto& entry : filesystem::directory_iterator {"test"})
+        if (entry.path().extension() == ".t")
+        {
+            ifstream file {entry.path(), ios::binary};
+            programs += string {istreambuf_iterator<char> {file}, {}};
+        }
+
+    string corpus;
+    while (corpus.size() < size)    corpus += programs;
+
+    return corpus;
+}
+
+
+// Fastest of several timed runs of f, in seconds
+template <class F>
+double best_seconds (int repetitions, F&& f)
+{
+    double best = 1e300;
+
+    for (int i = 0; i < repetitions; ++i)
+    {
+        auto start = chrono::steady_clock::now();
+        f();
+        best = min(best, chrono::duration<double> {chrono::steady_clock::now() - start}.count());
+    }
+
+    return best;
+}
+
+
+// Takes output like an OutputSink and throws it away, counting the bytes
+struct DiscardSink
+{
+    char   scratch[4096];
+    size_t bytes = 0;
+
+    char* reserve (size_t)                { return scratch; }
+    void  commit  (char* end)             { bytes += end - scratch; }
+    void  append  (const char*, size_t n) { bytes += n; }
+    void  append  (string_view s)         { bytes += s.size(); }
+};
@@ -0,0 +1,62 @@
+// Writing and reading the binary token stream, and seeking into it with TokenStreamReader::at, which is checked against
+// reading from the start
+#include "bench.hpp"
+
+
+int main ()
+{
+    string corpus = make_corpus(16 << 20);
+
+    OutputBuffer stream;
+
+    double write_time = best_seconds(3, [&]
+    {
+        TokenStreamWriter writer;
+        lex_buffer(corpus, [&](const Token& token) { writer.add(token); });
+
+        stream.clear();
+        writer.write(stream);
+    });
+
+    TokenStreamReader   reader {{stream.data(), stream.size()}};
+    vector<TokenRecord> records;
+
+    double read_time = best_seconds(3, [&]
+    {
+        records.assign(reader.begin(), reader.end());
+    });
+
+    // Seek to a spread of tokens, on and between index entries, and to the last
+    vector<uint64_t> seeks;
+    for (uint64_t i = 0; i < reader.size(); i += 997)    seeks.push_back(i);
+    seeks.push_back(reader.size() - 1);
+
+    size_t mismatches = 0;
+
+    double seek_time = best_seconds(3, [&]
+    {
+        mismatches = 0;
+
+        for (uint64_t i : seeks)
+        {
+            TokenRecord        a = *reader.at(i);    // a copy, as the iterator holds the record
+            const TokenRecord& b = records[i];
+
+            mismatches += a.name != b.name || a.line != b.line || a.column != b.column || a.integer != b.integer ||
+                          a.text != b.text;
+        }
+    });
+
+    if (records.size() != reader.size() || reader.at(reader.size()) != reader.end() || mismatches)
+    {
+        cerr << "binary: seeking with at() disagrees with reading from the start\n";
+        return 1;
+    }
+
+    double mb = corpus.size() / 1e6;
+
+    cout << reader.size() << " tokens in " << stream.size() / (1 << 20) << " MiB\n" << fixed << setprecision(1)
+         << "lex + write      " << setw(8) << mb / write_time << " MB/s\n"
+         << "read             " << setw(8) << mb / read_time  << " MB/s\n"
+         << "at()             " << setw(8) << seek_time / seeks.size() * 1e6 << " us per seek\n";
+}
@@ -0,0 +1,76 @@
+// Column-only passes over lexed tokens: a vector of Token against the same tokens held in TokenColumns
+#include "bench.hpp"
+
+
+int main ()
+{
+    string corpus = make_corpus(16 << 20);
+
+    vector<Token> rows;
+
+    double row_fill = best_seconds(3, [&]
+    {
+        rows.clear();
+        lex_buffer(corpus, [&](Token t) { rows.push_back(move(t)); });
+    });
+
+    TokenColumns columns;
+
+    double column_fill = best_seconds(3, [&]
+    {
+        columns.clear();
+        Lexer {corpus.c_str()}.lex_into(columns, SIZE_MAX);
+    });
+
+    if (columns.size() != rows.size())
+    {
+        cerr << "columns: " << columns.size() << " tokens, expected " << rows.size() << '\n';
+        return 1;
+    }
+
+    for (size_t i = 0; i < columns.size(); ++i)
+        if (to_string(columns[i]) != to_string(rows[i]))
+        {
+            cerr << "columns: token " << i << " differs\n";
+            return 1;
+        }
+
+    array<size_t, static_cast<int>(TokenName::ERROR) + 1> row_counts, column_counts;
+    int row_widest = 0, column_widest = 0;
+
+    // A kind histogram and the widest column, the sort of pass a parser or a statistics report makes
+    double row_time = best_seconds(10, [&]
+    {
+        row_counts = {};
+        row_widest = 0;
+
+        for (auto& t : rows)
+        {
+            ++row_counts[static_cast<int>(t.name)];
+            row_widest = max(row_widest, t.column);
+        }
+    });
+
+    double column_time = best_seconds(10, [&]
+    {
+        column_counts = count_kinds(columns);
+        column_widest = *max_element(columns.column.begin(), columns.column.end());
+    });
+
+    if (row_counts != column_counts || row_widest != column_widest)
+    {
+        cerr << "columns: passes disagree\n";
+        return 1;
+    }
+
+    double million = rows.size() / 1e6;
+    double mb      = corpus.size() / 1e6;
+
+    cout << rows.size() << " tokens, " << sizeof (Token) << " bytes each as rows, "
+         << sizeof (uint8_t) + sizeof (int32_t) << " bytes read per token as columns\n"
+         << "vector<Token>   " << fixed << setprecision(1) << million / row_time    << " Mtokens/s\n"
+         << "TokenColumns    " << fixed << setprecision(1) << million / column_time << " Mtokens/s ("
+         << setprecision(2) << row_time / column_time << "x)\n" << setprecision(1)
+         << "filling rows    " << mb / row_fill    << " MB/s\n"
+         << "lex_into        " << mb / column_fill << " MB/s\n";
+}
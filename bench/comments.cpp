@@ -0,0 +1,78 @@
+// Block comment skipping: comment_end() and a bulk line count against stepping a Scanner through each character
+#include "bench.hpp"
+
+
+// The original loop, from just after the opening "/*"
+bool skip_comment_bytes (Scanner& s)
+{
+    while (s.next() != '\0')
+        if (s.peek() == '*' && s.next() == '/')
+        {
+            s.advance();
+            return true;
+        }
+
+    return false;
+}
+
+
+int main ()
+{
+    // Source files that open with a long licence header and have blocks of code commented out
+    string header = "/*\n";
+    for (int i = 0; i < 40; ++i)    header += " * Permission is hereby granted, free of charge, to any person\n";
+    header += " */\n";
+
+    string programs = make_corpus(1);
+    string commented = "/*\n" + programs.substr(0, 4096) + "\n*/\n";
+
+    string text;
+    while (text.size() < (16 << 20))    text += header + programs.substr(0, 2048) + commented;
+
+    vector<const char*> opens;
+    for (const char* p = text.c_str(); (p = strstr(p, "/*")); p += 2)    opens.push_back(p);
+
+    // Each comment is skipped from its opening "/*", and where it ends summed so that the two loops can be compared
+    auto skip_all = [&](auto&& skip_comment)
+    {
+        size_t total = 0, bytes = 0;
+
+        for (const char* open : opens)
+        {
+            Scanner s {open + 1};
+            skip_comment(s);
+
+            total += s.line * 1000003 + s.column;
+            bytes += s.pos - open;
+        }
+
+        return pair {total, bytes};
+    };
+
+    pair<size_t, size_t> old_end, new_end;
+
+    double old_time = best_seconds(5, [&] { old_end = skip_all(skip_comment_bytes); });
+
+    double new_time = best_seconds(5, [&]
+    {
+        new_end = skip_all([](Scanner& s)
+        {
+            auto [end, closed] = comment_end(s.pos + 1);
+            s.advance_to(end);
+            return closed;
+        });
+    });
+
+    if (old_end != new_end)
+    {
+        cerr << "comments: the comment loops end in different places\n";
+        return 1;
+    }
+
+    double mb = new_end.second / 1e6;
+
+    cout << opens.size() << " comments, " << new_end.second << " bytes of them\n" << fixed << setprecision(1)
+         << "byte at a time   " << setw(7) << mb / old_time << " MB/s\n"
+         << "comment_end      " << setw(7) << mb / new_time << " MB/s ("
+         << setprecision(2) << old_time / new_time << "x)\n";
+}
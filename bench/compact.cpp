@@ -0,0 +1,72 @@
+// Lexing to CompactToken spans against lexing to Token, and the heap allocations each makes
+#include "bench.hpp"
+
+#include <new>
+
+
+static size_t allocations = 0;
+
+void* operator new (size_t n)
+{
+    ++allocations;
+    if (void* p = malloc(n))    return p;
+    throw bad_alloc {};
+}
+
+void operator delete (void* p) noexcept            { free(p); }
+void operator delete (void* p, size_t) noexcept    { free(p); }
+
+
+int main ()
+{
+    string corpus = make_corpus(16 << 20);
+
+    // Each span must expand to the token the lexer would have made
+    {
+        Lexer tokens {corpus.c_str()}, spans {corpus.c_str()};
+
+        while (tokens.has_more())
+        {
+            Token        t = tokens.next_token();
+            CompactToken c = spans.next_compact();
+
+            if (to_string(to_token(c, corpus.c_str() + c.offset, t.line, t.column)) != to_string(t))
+            {
+                cerr << "compact: token at " << t.line << ", " << t.column << " differs\n";
+                return 1;
+            }
+        }
+    }
+
+    size_t count = 0, token_allocations = 0, span_allocations = 0;
+
+    double token_time = best_seconds(5, [&]
+    {
+        allocations = 0;
+        count = 0;
+
+        for (Lexer lexer {corpus.c_str()}; lexer.has_more(); ++count)    lexer.next_token();
+
+        token_allocations = allocations;
+    });
+
+    double span_time = best_seconds(5, [&]
+    {
+        allocations = 0;
+
+        for (Lexer lexer {corpus.c_str()}; lexer.has_more(); )    lexer.next_compact();
+
+        span_allocations = allocations;
+    });
+
+    double million = count / 1e6;
+
+    cout << count << " tokens, " << sizeof (Token) << " bytes as Token, " << sizeof (CompactToken)
+         << " bytes as CompactToken\n"
+         << "Token           " << fixed << setprecision(1) << million / token_time << " Mtokens/s    "
+         << token_allocations << " allocations\n"
+         << "CompactToken    " << fixed << setprecision(1) << million / span_time  << " Mtokens/s    "
+         << span_allocations << " allocations\n";
+
+    return span_allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+// Seeded generator of arbitrarily large programs in the token language, with a tunable mix of tokens. The same options
+// and seed give the same bytes on every run and platform. Included by bench.hpp, after the lexer.
+#include <random>    // mt19937_64
+
+
+struct CorpusOptions
+{
+    uint64_t seed              = 1;
+    double   keyword_ratio     = 0.3;     // share of statements that start with a keyword rather than an assignment
+    int      identifiers       = 1000;    // distinct identifiers to draw from
+    int      identifier_length = 10;      // longest identifier
+    int      string_length     = 24;      // longest string literal, not counting its quotes
+    double   escape_density    = 0.05;    // chance of each character in a string literal being an escape
+    double   comment_rate      = 0.1;     // chance of a block comment before each statement
+    int      comment_length    = 60;      // longest comment text
+    int      integer_digits    = 6;       // widest integer literal, at most 9
+    int      line_length       = 80;      // a line is broken after the first statement to reach this column
+    double   error_rate        = 0;       // chance of a lexical error in each statement
+};
+
+
+class CorpusGenerator
+{
+public:
+    explicit CorpusGenerator (const CorpusOptions& options) : options {options}, random {options.seed}
+    {
+        for (int i = 0; i < options.identifiers; ++i)
+        {
+            string name;
+            int    length = 1 + below(max(1, options.identifier_length));
+
+            name += letters[below(53)];
+            while (name.size() < size_t(length))    name += letters[below(letters.size())];
+
+            // A keyword would lex as one, so it becomes an identifier by growing a character
+            if (classify_word(name.data(), name.size()) != TokenName::IDENTIFIER)    name += '_';
+
+            names.push_back(move(name));
+        }
+    }
+
+    // Hand write() at least size bytes of whole statements, a block of about a MiB at a time
+    template <class Write>
+    void generate (size_t size, Write&& write)
+    {
+        size_t written = 0;
+
+        while (written < size)
+        {
+            text.clear();
+            while (text.size() < block_size && written + text.size() < size)    statement(0);
+
+            written += text.size();
+            write(string_view {text});
+        }
+    }
+
+private:
+    static constexpr size_t      block_size   = 1 << 20;
+    static constexpr string_view letters      = "_abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    static constexpr string_view unlexable    = "@#$^[]?:.~`";
+    static constexpr string_view binary_ops[] = {"*", "/", "%", "+", "-", "<", "<=", ">", ">=", "==", "!=", "&&", "||"};
+
+    CorpusOptions  options;
+    mt19937_64     random;
+    vector<string> names;
+    string         text;
+    size_t         line_start = 0;
+
+    // Uniform in [0, n). The modulo bias is far too small to matter here, and unlike the standard distributions this
+    // is the same with every standard library.
+    int  below  (size_t n)    { return static_cast<int>(random() % n); }
+    bool chance (double p)    { return (random() >> 11) * 0x1.0p-53 < p; }
+
+    void end_line (int depth)
+    {
+        text += '\n';
+        line_start = text.size();
+        text.append(4 * depth, ' ');
+    }
+
+    // Space between statements, breaking the line once it is long enough
+    void separate (int depth)
+    {
+        if (text.size() - line_start >= size_t(options.line_length))    end_line(depth);
+        else                                                             text += ' ';
+    }
+
+    void comment (int depth)
+    {
+        int length = 1 + below(max(1, options.comment_length));
+
+        text += "/* ";
+
+        for (int n = 0; n < length; )
+        {
+            // Words of letters only, so no '*' ever comes near the close
+            int word = min(length - n, 1 + below(8));
+            for (int i = 0; i < word; ++i)    text += letters[1 + below(52)];
+
+            n += word + 1;
+
+            if (text.size() - line_start >= size_t(options.line_length))    end_line(depth);
+            else                                                             text += ' ';
+        }
+
+        text += "*/";
+        separate(depth);
+    }
+
+    void integer ()
+    {
+        int digits = 1 + below(clamp(options.integer_digits, 1, 9));
+
+        text += static_cast<char>('1' + below(9));
+        for (int i = 1; i < digits; ++i)    text += static_cast<char>('0' + below(10));
+    }
+
+    void string_literal ()
+    {
+        int length = below(options.string_length + 1);
+
+        text += '"';
+
+        for (int i = 0; i < length; ++i)
+        {
+            if (chance(options.escape_density))    { text += below(2) ? "\\n" : "\\\\"; continue; }
+
+            // A quote or backslash from the printable range would end the string or start an escape
+            char c = static_cast<char>(' ' + below(95));
+            text += (c == '"' || c == '\\') ? '_' : c;
+        }
+
+        text += '"';
+    }
+
+    void character ()
+    {
+        if (below(4))    { text += '\''; text += letters[1 + below(52)]; text += '\''; }
+        else             text += "'\\n'";
+    }
+
+    void primary ()
+    {
+        switch (below(8))
+        {
+            case 0  :    integer();                                                           break;
+            case 1  :    character();                                                         break;
+            case 2  :    text += (below(2) ? "-" : "!");    primary();                        break;
+            default :    text += names[below(names.size())];                                  break;
+        }
+    }
+
+    void expression (int terms = 0)
+    {
+        if (terms == 0)    terms = 1 + below(4);
+
+        primary();
+
+        for (int i = 1; i < terms; ++i)
+        {
+            text += ' ';
+            text += binary_ops[below(size(binary_ops))];
+            text += ' ';
+
+            if (below(6) == 0)    { text += '('; expression(1 + below(2)); text += ')'; }
+            else                  primary();
+        }
+    }
+
+    // Something the lexer reports as an Error, kept to the one line
+    void error (int depth)
+    {
+        switch (below(7))
+        {
+            case 0  :    text += unlexable[below(unlexable.size())];    break;
+            case 1  :    text += "''";                                   break;
+            case 2  :    text += "'ab'";                                 break;
+            case 3  :    text += "12abc";                                break;
+            case 4  :    text += "99999999999";                          break;
+            case 5  :    text += "\"\\q\"";                              break;
+            default :    text += "\"unterminated";    end_line(depth);   return;
+        }
+
+        text += ' ';
+    }
+
+    void block (int depth)
+    {
+        text += '{';
+        end_line(depth + 1);
+
+        for (int n = 1 + below(4); n > 0; --n)    statement(depth + 1);
+
+        text.resize(text.find_last_not_of(" \n") + 1);
+        end_line(depth);
+        text += '}';
+    }
+
+    void statement (int depth)
+    {
+        if (chance(options.comment_rate))    comment(depth);
+        if (chance(options.error_rate))      error(depth);
+
+        if (!chance(options.keyword_ratio))
+        {
+            text += names[below(names.size())];
+            text += " = ";
+            expression();
+            text += ';';
+        }
+        else switch (below(depth < 3 ? 4 : 2))
+        {
+            case 0  :    text += "print(";
+                         string_literal();
+                         text += ", ";
+                         expression();
+                         text += ");";
+                         break;
+
+            case 1  :    text += "putc(";
+                         expression();
+                         text += ");";
+                         break;
+
+            case 2  :    text += "while (";
+                         expression();
+                         text += ") ";
+                         block(depth);
+                         break;
+
+            default :    text += "if (";
+                         expression();
+                         text += ") ";
+                         block(depth);
+
+                         if (below(2))    { text += " else "; block(depth); }
+                         break;
+        }
+
+        separate(depth);
+    }
+}; // class CorpusGenerator
+
+
+// A generated program of at least size bytes
+inline string generate_corpus (size_t size, const CorpusOptions& options = {})
+{
+    string corpus;
+    CorpusGenerator {options}.generate(size, [&](string_view block) { corpus += block; });
+
+    return corpus;
+}
@@ -0,0 +1,63 @@
+// The table-driven engine against the switch, lexing the same sources to CompactTokens. The lexer is included a second
+// time, built with LEX_DFA, inside namespace table; the standard and system headers it names are already included by
+// then, so only its own definitions are repeated.
+#include "bench.hpp"
+
+namespace table
+{
+#define LEX_DFA
+#include "../lex.cpp"
+}
+
+
+// Lex all of source, folding every token into a checksum so that the two engines can be checked against each other
+template <class Lexer>
+uint64_t lex_all (const string& source)
+{
+    uint64_t sum = 0;
+
+    for (Lexer lexer {source.c_str()}; lexer.has_more(); )
+    {
+        auto t = lexer.next_compact();
+        sum = sum * 31 + (static_cast<uint64_t>(t.name) ^ t.offset ^ (uint64_t(t.length) << 20) ^ uint32_t(t.value));
+    }
+
+    return sum;
+}
+
+
+int main ()
+{
+    struct Input { const char* name; string source; };
+
+    Input inputs[] = {
+        {"test programs", make_corpus(16 << 20)},
+        {"generated",     generate_corpus(16 << 20)},
+    };
+
+    cout << "                 switch      table\n" << fixed << setprecision(1);
+
+    for (auto& [name, source] : inputs)
+    {
+        uint64_t by_switch = 0, by_table = 0;
+        double   switch_time = 1e300, table_time = 1e300;
+
+        // Alternated, so that a slow patch on the machine doesn't fall on one engine alone
+        for (int i = 0; i < 7; ++i)
+        {
+            switch_time = min(switch_time, best_seconds(1, [&] { by_switch = lex_all<OffsetLexer>(source); }));
+            table_time  = min(table_time,  best_seconds(1, [&] { by_table  = lex_all<table::OffsetLexer>(source); }));
+        }
+
+        if (by_switch != by_table)
+        {
+            cerr << "engines: the table gives different tokens from the switch on " << name << '\n';
+            return 1;
+        }
+
+        double mb = source.size() / 1e6;
+
+        cout << left << setw(14) << name << right << setw(8) << mb / switch_time << setw(11) << mb / table_time
+             << " MB/s    " << setprecision(2) << switch_time / table_time << "x\n" << setprecision(1);
+    }
+}
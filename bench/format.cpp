@@ -0,0 +1,62 @@
+// Output formatting throughput: write_token() against the original ostringstream-based to_string
+#include "bench.hpp"
+
+#include <sstream>
+
+
+// The original formatter, kept as the reference the new one is measured against
+string to_string_ostream (const Token& t)
+{
+    ostringstream out;
+    out << setw(2) << t.line << "   " << setw(2) << t.column  << "   ";
+
+    switch (t.name)
+    {
+        case (TokenName::IDENTIFIER)   : out << "Identifier        "   << get<string>(t.value);                  break;
+        case (TokenName::INTEGER)      : out << "Integer           "   << left << get<int>(t.value);             break;
+        case (TokenName::STRING)       : out << "String            \"" << sanitize(get<string>(t.value)) << '"'; break;
+        case (TokenName::END_OF_INPUT) : out << "End_of_input";                                                  break;
+        case (TokenName::ERROR)        : out << "Error             "   << get<string>(t.value);                  break;
+        default                        : out << to_cstring(t.name);
+    }
+
+    out << '\n';
+
+    return out.str();
+}
+
+
+int main ()
+{
+    string        corpus = make_corpus(16 << 20);
+    vector<Token> tokens;
+
+    lex_buffer(corpus, [&](Token t) { tokens.push_back(move(t)); });
+
+    string       before;
+    OutputBuffer after;
+
+    double old_time = best_seconds(3, [&]
+    {
+        before.clear();
+        for (auto& t : tokens)    before += to_string_ostream(t);
+    });
+
+    double new_time = best_seconds(10, [&]
+    {
+        after.clear();
+        for (auto& t : tokens)    write_token(after, t);
+    });
+
+    if (string_view {after.data(), after.size()} != before)
+    {
+        cerr << "format: output differs from the ostringstream formatter\n";
+        return 1;
+    }
+
+    double gb = before.size() / 1e9;
+
+    cout << tokens.size() << " tokens, " << before.size() << " bytes of output\n"
+         << "ostringstream   " << fixed << setprecision(3) << gb / old_time << " GB/s\n"
+         << "write_token     " << fixed << setprecision(3) << gb / new_time << " GB/s\n";
+}
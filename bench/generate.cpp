@@ -0,0 +1,110 @@
+// Write a seeded synthetic program of any size, or with no -o, generate one in memory and report its token mix and how
+// fast it generates and lexes. Sizes take a K, M or G suffix.
+//
+//     bench/generate [--size n] [--seed n] [-o file | -o -] [--keywords ratio] [--identifiers n]
+//                    [--identifier-length n] [--string-length n] [--escapes density] [--comments rate]
+//                    [--comment-length n] [--digits n] [--line-length n] [--errors rate]
+#include "bench.hpp"
+
+
+size_t parse_size (const string& text)
+{
+    size_t end;
+    size_t n = stoul(text, &end);
+
+    switch (end < text.size() ? toupper(text[end]) : 0)
+    {
+        case 'G' :    return n << 30;
+        case 'M' :    return n << 20;
+        case 'K' :    return n << 10;
+        default  :    return n;
+    }
+}
+
+
+int main (int argc, char* argv[])
+{
+    CorpusOptions options;
+    size_t        size = 16 << 20;
+    string        output;
+
+    for (int i = 1; i < argc; i += 2)
+    {
+        string arg = argv[i];
+
+        if (i + 1 == argc)    { cerr << "generate: missing value for " << arg << '\n'; return 2; }
+
+        string value = argv[i + 1];
+
+        if      (arg == "--size")                 size                      = parse_size(value);
+        else if (arg == "--seed")                 options.seed              = stoull(value);
+        else if (arg == "-o")                     output                    = value;
+        else if (arg == "--keywords")             options.keyword_ratio     = stod(value);
+        else if (arg == "--identifiers")          options.identifiers       = max(1, stoi(value));
+        else if (arg == "--identifier-length")    options.identifier_length = stoi(value);
+        else if (arg == "--string-length")        options.string_length     = stoi(value);
+        else if (arg == "--escapes")              options.escape_density    = stod(value);
+        else if (arg == "--comments")             options.comment_rate      = stod(value);
+        else if (arg == "--comment-length")       options.comment_length    = stoi(value);
+        else if (arg == "--digits")               options.integer_digits    = stoi(value);
+        else if (arg == "--line-length")          options.line_length       = stoi(value);
+        else if (arg == "--errors")               options.error_rate        = stod(value);
+        else                                      { cerr << "generate: unknown option " << arg << '\n'; return 2; }
+    }
+
+    if (!output.empty())
+    {
+        int fd = (output == "-") ? 1 : open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0)    { perror(("generate: " + output).c_str()); return 1; }
+
+        OutputSink out {fd};
+        CorpusGenerator {options}.generate(size, [&](string_view block) { out.append(block); });
+        out.flush();
+
+        return 0;
+    }
+
+    string corpus;
+    double generate_time = best_seconds(1, [&] { corpus = generate_corpus(size, options); });
+
+    array<size_t, static_cast<int>(TokenName::ERROR) + 1> counts {};
+    size_t                                                 lines = count_newlines(corpus.data(), corpus.size()) + 1;
+
+    double lex_time = best_seconds(3, [&]
+    {
+        counts = {};
+        Lexer {corpus.c_str()}.run([&](const TokenSpan& t) { ++counts[static_cast<int>(t.name)]; });
+    });
+
+    size_t tokens = 0;
+    for (size_t n : counts)    tokens += n;
+
+    auto share = [&](initializer_list<TokenName> names)
+    {
+        size_t n = 0;
+        for (auto name : names)    n += counts[static_cast<int>(name)];
+
+        return 100.0 * n / tokens;
+    };
+
+    double mb = corpus.size() / 1e6;
+
+    cout << corpus.size() / (1 << 20) << " MiB, " << lines << " lines, " << tokens << " tokens, seed " << options.seed
+         << '\n' << fixed << setprecision(1)
+         << "identifiers    " << setw(6) << share({TokenName::IDENTIFIER}) << " %\n"
+         << "keywords       " << setw(6) << share({TokenName::KEYWORD_IF, TokenName::KEYWORD_ELSE,
+                                                   TokenName::KEYWORD_WHILE, TokenName::KEYWORD_PRINT,
+                                                   TokenName::KEYWORD_PUTC}) << " %\n"
+         << "integers       " << setw(6) << share({TokenName::INTEGER}) << " %\n"
+         << "strings        " << setw(6) << share({TokenName::STRING}) << " %\n"
+         << "errors         " << setw(6) << share({TokenName::ERROR}) << " %\n"
+         << "generated at   " << setw(6) << mb / generate_time << " MB/s\n"
+         << "lexed at       " << setw(6) << mb / lex_time << " MB/s\n";
+
+    // Without errors asked for, every generated program should lex cleanly
+    if (options.error_rate == 0 && counts[static_cast<int>(TokenName::ERROR)] != 0)
+    {
+        cerr << "generate: a program generated without errors lexed with some\n";
+        return 1;
+    }
+}
@@ -0,0 +1,69 @@
+// Lexing through a TokenGenerator with budgets: throughput against a plain loop, and the longest stretch the caller
+// waits between getting control back
+#include "bench.hpp"
+
+
+int main ()
+{
+    string corpus = make_corpus(16 << 20);
+
+    size_t loop_tokens = 0;
+    double loop_time = best_seconds(3, [&]
+    {
+        loop_tokens = 0;
+        for (Lexer lexer {corpus.c_str()}; lexer.has_more(); ++loop_tokens)    lexer.next_token();
+    });
+
+    cout << fixed << setprecision(1)
+         << "plain loop              " << setw(7) << corpus.size() / loop_time / 1e6 << " MB/s\n";
+
+    const pair<const char*, LexBudget> budgets[] =
+    {
+        {"64 KiB",        {.bytes = 64 << 10}},
+        {"1000 tokens",   {.tokens = 1000}},
+        {"100 us",        {.time = chrono::microseconds {100}}}
+    };
+
+    for (auto& [label, budget] : budgets)
+    {
+        size_t tokens = 0, pauses = 0;
+        double longest = 0;
+        bool   stays_finished = false;
+
+        double time = best_seconds(3, [&]
+        {
+            tokens = pauses = 0;
+            longest = 0;
+
+            auto generator = generate_tokens(corpus.c_str(), budget);
+            auto since     = chrono::steady_clock::now();
+
+            while (generator.resume())
+            {
+                if (!generator.paused())    { ++tokens; continue; }
+
+                auto now = chrono::steady_clock::now();
+                longest  = max(longest, chrono::duration<double> {now - since}.count());
+                since    = now;
+                ++pauses;
+            }
+
+            stays_finished = !generator.resume();
+        });
+
+        if (tokens != loop_tokens)
+        {
+            cerr << "generator: " << tokens << " tokens, expected " << loop_tokens << '\n';
+            return 1;
+        }
+
+        if (!stays_finished)
+        {
+            cerr << "generator: resumed past the end of its source\n";
+            return 1;
+        }
+
+        cout << "budget " << setw(12) << left << label << right << setw(9) << corpus.size() / time / 1e6 << " MB/s    "
+             << setw(6) << pauses << " pauses, longest " << setw(7) << longest * 1e6 << " us between them\n";
+    }
+}
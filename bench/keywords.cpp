@@ -0,0 +1,79 @@
+// Keyword recognition: classify_word() against the std::map lookup it replaced, on keyword-dense and keyword-free words
+#include "bench.hpp"
+
+#include <map>
+
+
+// The original lookup, which needed the word as a string
+const map<string, TokenName> keywords =
+{
+    {"else",  TokenName::KEYWORD_ELSE},
+    {"if",    TokenName::KEYWORD_IF},
+    {"print", TokenName::KEYWORD_PRINT},
+    {"putc",  TokenName::KEYWORD_PUTC},
+    {"while", TokenName::KEYWORD_WHILE}
+};
+
+TokenName classify_map (const char* p, size_t n)
+{
+    auto i = keywords.find(string {p, n});
+    return i != keywords.end() ? i->second : TokenName::IDENTIFIER;
+}
+
+
+// Words separated by single spaces, cycling through the given ones
+string make_words (const vector<string>& words, size_t size)
+{
+    string text;
+    for (size_t i = 0; text.size() < size; ++i)    text += words[i % words.size()] + ' ';
+
+    return text;
+}
+
+
+template <class Classify>
+size_t classify_all (const string& text, Classify&& classify)
+{
+    size_t keywords = 0;
+
+    for (size_t begin = 0, end; begin < text.size(); begin = end + 1)
+    {
+        end = text.find(' ', begin);
+        keywords += classify(text.data() + begin, end - begin) != TokenName::IDENTIFIER;
+    }
+
+    return keywords;
+}
+
+
+int main ()
+{
+    // Identifiers that share a length and first letter with a keyword are the hard case for the switch
+    const vector<pair<const char*, vector<string>>> inputs =
+    {
+        {"keyword-dense", {"if", "else", "while", "print", "putc", "x", "if", "print"}},
+        {"keyword-free",  {"count", "index", "total", "elsewhere", "iff", "whale", "puts", "printer", "x", "n_1"}}
+    };
+
+    for (auto& [label, words] : inputs)
+    {
+        string text = make_words(words, 4 << 20);
+        size_t count = count_if(text.begin(), text.end(), [](char c) { return c == ' '; });
+
+        size_t map_keywords = 0, switch_keywords = 0;
+
+        double map_time    = best_seconds(5, [&] { map_keywords    = classify_all(text, classify_map);  });
+        double switch_time = best_seconds(5, [&] { switch_keywords = classify_all(text, classify_word); });
+
+        if (map_keywords != switch_keywords)
+        {
+            cerr << "keywords: " << label << " classified differently\n";
+            return 1;
+        }
+
+        cout << setw(14) << left << label << right
+             << "std::map " << setw(7) << fixed << setprecision(1) << map_time / count * 1e9    << " ns/word    "
+             << "switch "   << setw(5) << fixed << setprecision(1) << switch_time / count * 1e9 << " ns/word    "
+             << setprecision(1) << map_time / switch_time << "x\n";
+    }
+}
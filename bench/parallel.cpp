@@ -0,0 +1,59 @@
+// Scaling of lex_parallel with the number of threads, against lex_buffer on one, lexing and formatting a large file:
+// the test programs repeated, and a single block comment of the same size, as a file that is mostly commented out is
+#include "bench.hpp"
+
+
+int main (int argc, char* argv[])
+{
+    size_t size = (argc > 1) ? stoul(argv[1]) << 20 : 64 << 20;
+
+    string line    = " * Permission is hereby granted, free of charge, to any person obtaining a copy\n";
+    string comment = "/*\n";
+    while (comment.size() < size)    comment += line;
+    comment += " */\nx = 1;\n";
+
+    struct Input { const char* name; string source; };
+
+    Input inputs[] = {
+        {"test programs", make_corpus(size)},
+        {"one comment",   move(comment)},
+    };
+
+    auto format = [](auto& out, const Token& token) { write_token(out, token); };
+
+    cout << size / (1 << 20) << " MiB, " << thread::hardware_concurrency() << " hardware threads\n";
+
+    for (auto& [name, corpus] : inputs)
+    {
+        DiscardSink sequential;
+
+        double base = best_seconds(3, [&]
+        {
+            sequential = {};
+            lex_buffer(corpus, [&](const Token& token) { write_token(sequential, token); });
+        });
+
+        cout << '\n' << name << '\n'
+             << "sequential    " << fixed << setprecision(1) << setw(8) << corpus.size() / base / 1e6 << " MB/s\n";
+
+        for (int jobs = 1; jobs <= 64; jobs *= 2)
+        {
+            DiscardSink parallel;
+
+            double time = best_seconds(3, [&]
+            {
+                parallel = {};
+                lex_parallel(corpus, jobs, 0, parallel, format);
+            });
+
+            if (parallel.bytes != sequential.bytes)
+            {
+                cerr << "parallel: output size differs from the sequential lexer on " << name << '\n';
+                return 1;
+            }
+
+            cout << setw(2) << jobs << " threads    " << setw(8) << corpus.size() / time / 1e6 << " MB/s    "
+                 << setprecision(2) << base / time << "x\n" << setprecision(1);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+// Lexing with positions counted by the Scanner against lexing to offsets and resolving them from a LineIndex
+#include "bench.hpp"
+
+
+int main ()
+{
+    string corpus = make_corpus(16 << 20);
+
+    DiscardSink counted, resolved;
+    OutputBuffer first, second;
+
+    // Both must give the same output, down to every line and column
+    lex_buffer(corpus,  [&](const Token& t) { write_token(first,  t); });
+    lex_offsets(corpus, [&](const Token& t) { write_token(second, t); });
+
+    if (string_view {first.data(), first.size()} != string_view {second.data(), second.size()})
+    {
+        cerr << "positions: output differs\n";
+        return 1;
+    }
+
+    double counted_time = best_seconds(5, [&]
+    {
+        counted = {};
+        lex_buffer(corpus, [&](const Token& t) { write_token(counted, t); });
+    });
+
+    double resolved_time = best_seconds(5, [&]
+    {
+        resolved = {};
+        lex_offsets(corpus, [&](const Token& t) { write_token(resolved, t); });
+    });
+
+    size_t tokens = 0;
+    double offsets_time = best_seconds(5, [&]
+    {
+        tokens = 0;
+        for (OffsetLexer lexer {corpus.c_str()}; lexer.has_more(); ++tokens)    lexer.next_compact();
+    });
+
+    double compact_time = best_seconds(5, [&]
+    {
+        for (Lexer lexer {corpus.c_str()}; lexer.has_more(); )    lexer.next_compact();
+    });
+
+    double index_time = best_seconds(5, [&] { LineIndex {corpus}; });
+
+    double mb = corpus.size() / 1e6;
+
+    cout << corpus.size() << " bytes, " << tokens << " tokens\n" << fixed << setprecision(1)
+         << "counted by the Scanner   " << setw(7) << mb / counted_time  << " MB/s\n"
+         << "resolved from offsets    " << setw(7) << mb / resolved_time << " MB/s ("
+         << setprecision(2) << counted_time / resolved_time << "x)\n" << setprecision(1)
+         << "spans, counting lines    " << setw(7) << mb / compact_time  << " MB/s\n"
+         << "spans, offsets only      " << setw(7) << mb / offsets_time  << " MB/s\n"
+         << "LineIndex                " << setw(7) << mb / index_time    << " MB/s\n";
+}
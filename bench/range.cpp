@@ -0,0 +1,54 @@
+// Consuming tokens through TokenRange and SpanRange, with and without <ranges> adaptors, against calling the lexer
+#include "bench.hpp"
+
+
+int main ()
+{
+    string corpus = make_corpus(16 << 20);
+    auto   is_identifier = [](const auto& t) { return t.name == TokenName::IDENTIFIER; };
+
+    size_t loop_count = 0, range_count = 0, view_count = 0, span_count = 0;
+
+    double loop_time = best_seconds(5, [&]
+    {
+        loop_count = 0;
+
+        for (Lexer lexer {corpus.c_str()}; lexer.has_more(); )
+            loop_count += is_identifier(lexer.next_token());
+    });
+
+    double range_time = best_seconds(5, [&]
+    {
+        range_count = 0;
+        for (const Token& t : TokenRange {corpus.c_str()})    range_count += is_identifier(t);
+    });
+
+    double view_time = best_seconds(5, [&]
+    {
+        view_count = 0;
+
+        auto columns = TokenRange {corpus.c_str()} | views::filter(is_identifier)
+                                                   | views::transform([](const Token& t) { return t.column; });
+        for (int column : columns)    view_count += column > 0;
+    });
+
+    double span_time = best_seconds(5, [&]
+    {
+        span_count = 0;
+        for (const CompactToken& t : SpanRange {corpus.c_str()})    span_count += is_identifier(t);
+    });
+
+    if (range_count != loop_count || view_count != loop_count || span_count != loop_count)
+    {
+        cerr << "range: identifier counts differ\n";
+        return 1;
+    }
+
+    double mb = corpus.size() / 1e6;
+
+    cout << loop_count << " identifiers\n" << fixed << setprecision(1)
+         << "next_token loop       " << setw(7) << mb / loop_time  << " MB/s\n"
+         << "TokenRange            " << setw(7) << mb / range_time << " MB/s\n"
+         << "filter | transform    " << setw(7) << mb / view_time  << " MB/s\n"
+         << "SpanRange             " << setw(7) << mb / span_time  << " MB/s\n";
+}
@@ -0,0 +1,50 @@
+// Re-lexing after small edits to a 1 MB source with relex(), against lexing the whole source again
+#include "bench.hpp"
+
+#include <random>
+
+
+int main ()
+{
+    string source = make_corpus(1 << 20);
+    auto   tokens = lex_spans(source);
+
+    mt19937 random {42};
+    const char edits[] = "abz_019 \n;+=<>&|/*\"'\\";
+
+    size_t edits_made = 2000;
+    double relex_time = 0, full_time = 0;
+
+    for (size_t i = 0; i < edits_made; ++i)
+    {
+        // Insert, delete or replace a single character
+        auto     offset   = static_cast<uint32_t>(random() % source.size());
+        uint32_t removed  = random() % 3 == 0 ? 0 : 1;
+        string   inserted = random() % 3 == 1 ? "" : string(1, edits[random() % (sizeof edits - 1)]);
+
+        source.replace(offset, removed, inserted);
+
+        double time = best_seconds(1, [&] { relex(tokens, source, {offset, removed, inserted}); });
+        relex_time += time;
+
+        // Check against lexing from scratch after every edit
+        vector<CompactToken> whole;
+        full_time += best_seconds(1, [&] { whole = lex_spans(source); });
+
+        auto same = [](const CompactToken& a, const CompactToken& b)
+        {
+            return a.name == b.name && a.offset == b.offset && a.length == b.length && a.value == b.value;
+        };
+
+        if (!equal(tokens.begin(), tokens.end(), whole.begin(), whole.end(), same))
+        {
+            cerr << "relex: tokens differ from a full lex after edit " << i << " at offset " << offset << '\n';
+            return 1;
+        }
+    }
+
+    cout << source.size() << " bytes, " << tokens.size() << " tokens, " << edits_made << " single-character edits\n"
+         << fixed << setprecision(1)
+         << "relex        " << setw(9) << relex_time / edits_made * 1e6 << " us per edit\n"
+         << "full lex     " << setw(9) << full_time / edits_made * 1e6  << " us per edit\n";
+}
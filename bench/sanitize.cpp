@@ -0,0 +1,72 @@
+// Escaping string literals for output: write_escaped() against the original replace()-in-a-loop sanitize, on literals
+// of doubling size. Time per byte stays flat for a linear pass and doubles with each size for a quadratic one.
+#include "bench.hpp"
+
+#include <random>
+
+
+// The original sanitize, kept as the reference
+string sanitize_replace (string s)
+{
+    for (int i = 0; i < s.size(); ++i)
+    {
+        if      (s[i] == '\n')    s.replace(i++, 1, "\\n");
+        else if (s[i] == '\\')    s.replace(i++, 1, "\\\\");
+    }
+
+    return s;
+}
+
+
+// A decoded literal where about one byte in eight needs escaping
+string make_literal (size_t size)
+{
+    mt19937      random {42};
+    const char   alphabet[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    string       s (size, ' ');
+
+    for (auto& c : s)
+        switch (random() % 16)
+        {
+            case 0  :    c = '\n'; break;
+            case 1  :    c = '\\'; break;
+            default :    c = alphabet[random() % (sizeof alphabet - 1)];
+        }
+
+    return s;
+}
+
+
+void report (const char* name, size_t size, double seconds)
+{
+    cout << left << setw(16) << name << right << setw(10) << size / 1024 << " KiB"
+         << fixed << setprecision(3) << setw(10) << seconds * 1e9 / size << " ns/byte"
+         << setw(10) << size / seconds / 1e9 << " GB/s\n";
+}
+
+
+int main ()
+{
+    for (size_t size = 16 << 10; size <= 256 << 10; size *= 2)
+    {
+        string literal = make_literal(size);
+        string escaped;
+
+        report("replace", size, best_seconds(3, [&] { escaped = sanitize_replace(literal); }));
+
+        if (sanitize(literal) != escaped)
+        {
+            cerr << "sanitize: output differs from the replace() version\n";
+            return 1;
+        }
+    }
+
+    OutputBuffer out;
+
+    for (size_t size = 1 << 20; size <= 64 << 20; size *= 2)
+    {
+        string literal = make_literal(size);
+
+        report("write_escaped", size, best_seconds(5, [&] { out.clear(); write_escaped(out, literal); }));
+    }
+}
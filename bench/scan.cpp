@@ -0,0 +1,79 @@
+// Whitespace and identifier scanning: the vectorised runs the Scanner uses against byte-at-a-time loops
+#include "bench.hpp"
+
+
+// The original loops, stepping a Scanner one byte at a time
+void skip_whitespace_bytes (Scanner& s)
+{
+    while (isspace(static_cast<unsigned char>(s.peek())))    s.advance();
+}
+
+void skip_word_bytes (Scanner& s)
+{
+    while (isalnum(static_cast<unsigned char>(s.peek())) || s.peek() == '_')    s.advance();
+}
+
+
+int main ()
+{
+    // Indented blank-line-heavy code, and code with long descriptive names
+    string spaces, words;
+
+    for (int i = 0; spaces.size() < (16 << 20); ++i)
+        spaces += "\n\n" + string(4 * (i % 8), ' ') + "x\t\t=   " + std::to_string(i) + ";" + string(i % 40, ' ');
+
+    for (int i = 0; words.size() < (16 << 20); ++i)
+        words += "number_of_remaining_items_in_the_queue_" + std::to_string(i) + " = total_count_so_far_" +
+                 std::to_string(i % 97) + ";\n";
+
+    for (auto [label, text] : {pair {"whitespace-heavy", &spaces}, pair {"long identifiers", &words}})
+    {
+        const char* source = text->c_str();
+        Scanner     old_end {source}, new_end {source};
+
+        // Both walk the same text alternately skipping a run of whitespace and a run of word characters, and stepping
+        // over the single byte after them
+        auto walk = [&](Scanner& s, auto&& skip_whitespace, auto&& skip_word)
+        {
+            s = Scanner {source};
+
+            while (s.peek() != '\0')
+            {
+                skip_whitespace(s);
+                skip_word(s);
+                if (s.peek() != '\0' && !isspace(static_cast<unsigned char>(s.peek())))    s.advance();
+            }
+        };
+
+        double old_time = best_seconds(5, [&]
+        {
+            walk(old_end, skip_whitespace_bytes, skip_word_bytes);
+        });
+
+        double new_time = best_seconds(5, [&]
+        {
+            walk(new_end, [](Scanner& s) { s.skip_whitespace(); }, [](Scanner& s) { s.skip_to(skip_word(s.pos)); });
+        });
+
+        if (old_end.line != new_end.line || old_end.column != new_end.column)
+        {
+            cerr << "scan: " << label << " ends at a different line and column\n";
+            return 1;
+        }
+
+        size_t tokens = 0;
+        double lex_time = best_seconds(5, [&]
+        {
+            tokens = 0;
+            for (Lexer lexer {source}; lexer.has_more(); ++tokens)    lexer.next_compact();
+        });
+
+        double mb = text->size() / 1e6;
+
+        cout << setw(18) << left << label << right << fixed << setprecision(1)
+             << "bytes " << setw(7) << mb / old_time << " MB/s    "
+             << "vectors " << setw(7) << mb / new_time << " MB/s    "
+             << setprecision(2) << old_time / new_time << "x    "
+             << "lexer " << setprecision(1) << mb / lex_time << " MB/s\n";
+    }
+}
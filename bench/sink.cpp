@@ -0,0 +1,75 @@
+// Pushing tokens into sinks through Lexer::run, against pulling Tokens with next_token and formatting those
+#include "bench.hpp"
+
+
+// Counts tokens of each kind
+struct CountingSink
+{
+    array<size_t, static_cast<int>(TokenName::ERROR) + 1> counts {};
+
+    void operator() (const TokenSpan& t)    { ++counts[static_cast<int>(t.name)]; }
+};
+
+
+// Folds every token's kind and text into an FNV-1a hash
+struct HashingSink
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    void operator() (const TokenSpan& t)
+    {
+        hash = (hash ^ static_cast<uint8_t>(t.name)) * 1099511628211ull;
+        for (char c : t.text)    hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+};
+
+
+int main ()
+{
+    string corpus = make_corpus(16 << 20);
+
+    OutputBuffer pulled, pushed;
+    CountingSink counting;
+    HashingSink  hashing;
+
+    double pull_time = best_seconds(5, [&]
+    {
+        pulled.clear();
+        for (Lexer lexer {corpus.c_str()}; lexer.has_more(); )    write_token(pulled, lexer.next_token());
+    });
+
+    double text_time = best_seconds(5, [&]
+    {
+        pushed.clear();
+        Lexer {corpus.c_str()}.run(TextSink {pushed});
+    });
+
+    double count_time = best_seconds(5, [&]
+    {
+        counting = {};
+        Lexer {corpus.c_str()}.run(counting);
+    });
+
+    double hash_time = best_seconds(5, [&]
+    {
+        hashing = {};
+        Lexer {corpus.c_str()}.run(hashing);
+    });
+
+    if (string_view {pulled.data(), pulled.size()} != string_view {pushed.data(), pushed.size()})
+    {
+        cerr << "sink: text output differs\n";
+        return 1;
+    }
+
+    size_t tokens = 0;
+    for (size_t n : counting.counts)    tokens += n;
+
+    double mb = corpus.size() / 1e6;
+
+    cout << tokens << " tokens, hash " << hex << hashing.hash << dec << '\n' << fixed << setprecision(1)
+         << "next_token + write_token  " << setw(7) << mb / pull_time  << " MB/s\n"
+         << "run(TextSink)             " << setw(7) << mb / text_time  << " MB/s\n"
+         << "run(CountingSink)         " << setw(7) << mb / count_time << " MB/s\n"
+         << "run(HashingSink)          " << setw(7) << mb / hash_time  << " MB/s\n";
+}
@@ -0,0 +1,129 @@
+// Time to first byte, total time and peak RSS of the lex command itself, reading a large file from a mapping and from a
+// pipe, and on several threads. Output is read from a pipe as a downstream stage would.
+#include "bench.hpp"
+
+#include <sys/resource.h>    // rusage
+#include <sys/wait.h>        // wait4
+
+
+struct StreamRun
+{
+    double ttfb    = 0;    // seconds until the first byte of output
+    double total   = 0;    // seconds until the end of output
+    size_t bytes   = 0;    // of output
+    long   peak_kb = 0;    // the child's peak RSS
+};
+
+
+// Run ./lex with args, its input from the file at input or, if piped, from a pipe fed by this process
+StreamRun run_lex (vector<string> args, const string& input, bool piped)
+{
+    int out[2], in[2];
+    if (pipe(out) != 0 || (piped && pipe(in) != 0))    throw (errno);
+
+    int file = open(input.c_str(), O_RDONLY);
+    if (file < 0)    throw (errno);
+
+    args.insert(args.begin(), "./lex");
+
+    vector<char*> argv;
+    for (auto& arg : args)    argv.push_back(arg.data());
+    argv.push_back(nullptr);
+
+    auto  start = chrono::steady_clock::now();
+    pid_t child = fork();
+
+    if (child == 0)
+    {
+        dup2(piped ? in[0] : file, 0);
+        dup2(out[1], 1);
+        if (piped)    { close(in[0]); close(in[1]); }
+        close(out[0]);
+        close(out[1]);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    close(out[1]);
+
+    thread feeder;
+
+    if (piped)
+    {
+        close(in[0]);
+
+        feeder = thread {[&]
+        {
+            vector<char> block (1 << 16);
+            ssize_t      n;
+
+            while ((n = read(file, block.data(), block.size())) > 0)
+                if (write(in[1], block.data(), n) != n)    break;
+
+            close(in[1]);
+        }};
+    }
+
+    StreamRun    run;
+    vector<char> block (1 << 16);
+    ssize_t      n;
+
+    while ((n = read(out[0], block.data(), block.size())) > 0)
+    {
+        if (run.bytes == 0)    run.ttfb = chrono::duration<double> {chrono::steady_clock::now() - start}.count();
+        run.bytes += n;
+    }
+
+    run.total = chrono::duration<double> {chrono::steady_clock::now() - start}.count();
+
+    if (feeder.joinable())    feeder.join();
+
+    int    status;
+    rusage usage;
+    wait4(child, &status, 0, &usage);
+    run.peak_kb = usage.ru_maxrss;
+
+    close(out[0]);
+    close(file);
+
+    return run;
+}
+
+
+int main (int argc, char* argv[])
+{
+    size_t size  = (argc > 1) ? stoul(argv[1]) << 20 : 256 << 20;
+    string input = (filesystem::temp_directory_path() / "lex-bench-stream.t").string();
+
+    {
+        string  corpus = make_corpus(size);
+        ofstream file {input, ios::binary};
+        file.write(corpus.data(), corpus.size());
+        size = corpus.size();
+    }
+
+    struct Case { const char* name; vector<string> args; bool piped; };
+
+    Case cases[] = {
+        {"mapped file",        {},                       false},
+        {"mapped, -j 4",       {"-j", "4"},              false},
+        {"pipe",               {},                       true},
+        {"mapped, --binary",   {"--binary"},             false},
+    };
+
+    cout << size / (1 << 20) << " MiB of input\n"
+         << "                      first byte      total    output    peak RSS\n";
+
+    for (auto& c : cases)
+    {
+        StreamRun run = run_lex(c.args, input, c.piped);
+
+        cout << left << setw(20) << c.name << right << fixed
+             << setprecision(2) << setw(10) << run.ttfb * 1e3 << " ms"
+             << setprecision(3) << setw(9)  << run.total << " s"
+             << setw(7) << run.bytes / (1 << 20) << " MiB"
+             << setw(8) << run.peak_kb / 1024 << " MiB\n";
+    }
+
+    filesystem::remove(input);
+}
@@ -0,0 +1,68 @@
+// Lexing multi-megabyte string literals: the vectorised scanner and bulk unescape() against a byte-at-a-time loop,
+// with a plain copy of the same bytes for scale
+#include "bench.hpp"
+
+
+// The original scanner, building the value one character at a time from just after the opening quote
+string string_lit_bytes (const char*& p)
+{
+    string text;
+
+    for (; *p != '"'; ++p)
+        if (*p == '\\')    text += *++p == 'n' ? '\n' : '\\';
+        else               text += *p;
+
+    ++p;
+    return text;
+}
+
+
+int main ()
+{
+    // A few literals of 4 MiB each, with an escape every kilobyte or so
+    string body;
+    for (int i = 0; body.size() < (4 << 20); ++i)
+        body += string(1000 + i % 50, 'a' + i % 26) + (i % 2 ? "\\n" : "\\\\");
+
+    string text;
+    for (int i = 0; i < 4; ++i)    text += "print(\"" + body + "\");\n";
+
+    const char* source = text.c_str();
+    size_t      old_bytes = 0, new_bytes = 0;
+
+    double old_time = best_seconds(5, [&]
+    {
+        old_bytes = 0;
+
+        for (const char* p = source; (p = strchr(p, '"')); )
+            old_bytes += string_lit_bytes(++p).size();
+    });
+
+    double new_time = best_seconds(5, [&]
+    {
+        new_bytes = 0;
+
+        for (Lexer lexer {source}; lexer.has_more(); )
+        {
+            Token t = lexer.next_token();
+            if (t.name == TokenName::STRING)    new_bytes += get<string>(t.value).size();
+        }
+    });
+
+    if (old_bytes != new_bytes)
+    {
+        cerr << "strings: the literals decode to different lengths\n";
+        return 1;
+    }
+
+    string copy (text.size(), '\0');
+    double copy_time = best_seconds(5, [&] { memcpy(copy.data(), source, text.size()); });
+
+    double mb = text.size() / 1e6;
+
+    cout << text.size() << " bytes of string literals\n" << fixed << setprecision(1)
+         << "byte at a time   " << setw(7) << mb / old_time  << " MB/s\n"
+         << "lexer            " << setw(7) << mb / new_time  << " MB/s (" << setprecision(2) << old_time / new_time
+         << "x)\n" << setprecision(1)
+         << "memcpy           " << setw(7) << mb / copy_time << " MB/s\n";
+}
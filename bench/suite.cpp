@@ -0,0 +1,386 @@
+// End-to-end throughput of the lexer, phase by phase: reading the input, lexing it, formatting the records and writing
+// them out, then all four together as the lex command does them. Each phase is timed over the test programs, the test
+// programs repeated out to a large size and a seeded generated program of that size, after warm-up runs, on one pinned
+// CPU. The median and spread of the repetitions are reported, and can be saved as a baseline for a later run to be
+// compared against.
+//
+//     bench/suite [--size MiB] [--seed n] [--reps n] [--warmup n] [--cpu n | --cpu -1] [--save file]
+//                 [--compare file] [--threshold percent]
+#include "bench.hpp"
+
+#include <sched.h>    // sched_setaffinity
+
+
+struct Input
+{
+    string name;
+    string path;      // the input, written out to a file for the read phase
+    size_t bytes  = 0;
+    size_t tokens = 0;
+};
+
+
+struct Result
+{
+    string input;
+    string phase;
+    size_t bytes  = 0;
+    size_t tokens = 0;
+    double p10    = 0;    // seconds per pass over the input
+    double median = 0;
+    double p90    = 0;
+
+    double mb_per_second     () const    { return bytes / median / 1e6; }
+    double tokens_per_second () const    { return tokens / median; }
+};
+
+
+struct SuiteOptions
+{
+    size_t   size      = 32 << 20;
+    uint64_t seed      = 1;     // for the generated input
+    int      reps      = 15;
+    int      warmup    = 3;
+    int      cpu       = -2;    // -2 for whichever CPU the suite starts on, -1 for no pinning
+    string   save;
+    string   compare;
+    double   threshold = 10;    // percent slower than the baseline that counts as a regression
+};
+
+
+// The value at fraction q of the way through sorted samples, by nearest rank
+double percentile (const vector<double>& sorted, double q)
+{
+    size_t rank = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[rank];
+}
+
+
+// Time pass over input, once per repetition after the warm-ups. A pass over a small input is repeated until it takes a
+// millisecond or so, so that each sample is well above the clock's resolution.
+template <class Pass>
+Result measure (const Input& input, string phase, const SuiteOptions& options, Pass&& pass)
+{
+    auto seconds = [&](int iterations)
+    {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)    pass();
+        return chrono::duration<double> {chrono::steady_clock::now() - start}.count();
+    };
+
+    int iterations = 1;
+    while (seconds(iterations) < 1e-3)    iterations *= 2;
+
+    for (int i = 0; i < options.warmup; ++i)    seconds(iterations);
+
+    vector<double> samples;
+    for (int i = 0; i < options.reps; ++i)    samples.push_back(seconds(iterations) / iterations);
+
+    sort(samples.begin(), samples.end());
+
+    return {input.name, move(phase), input.bytes, input.tokens,
+            percentile(samples, 0.1), percentile(samples, 0.5), percentile(samples, 0.9)};
+}
+
+
+string read_file (const string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)    throw (errno);
+
+    struct stat info;
+    fstat(fd, &info);
+
+    string contents (info.st_size, '\0');
+
+    for (size_t done = 0; done < contents.size(); )
+    {
+        ssize_t n = read(fd, contents.data() + done, contents.size() - done);
+        if (n <= 0)    { close(fd); throw (n < 0 ? errno : EIO); }
+        done += n;
+    }
+
+    close(fd);
+    return contents;
+}
+
+
+vector<Result> run_suite (const vector<Input>& inputs, const SuiteOptions& options)
+{
+    vector<Result> results;
+    string         output = (filesystem::temp_directory_path() / "lex-bench-suite.out").string();
+
+    for (const Input& input : inputs)
+    {
+        string source = read_file(input.path);
+
+        vector<TokenSpan> spans;
+        Lexer {source.c_str()}.run([&](const TokenSpan& t) { spans.push_back(t); });
+
+        OutputBuffer text;
+        for (const TokenSpan& t : spans)    write_token(text, t);
+
+        results.push_back(measure(input, "read", options, [&]
+        {
+            string contents = read_file(input.path);
+            if (contents.size() != input.bytes)    throw (EIO);
+        }));
+
+        results.push_back(measure(input, "lex", options, [&]
+        {
+            size_t tokens = 0;
+            Lexer {source.c_str()}.run([&](const TokenSpan&) { ++tokens; });
+            if (tokens != input.tokens)    throw (EIO);
+        }));
+
+        // Into a buffer that has already grown to fit, as the lex command's output buffer has after its first fill
+        OutputBuffer formatted;
+
+        results.push_back(measure(input, "format", options, [&]
+        {
+            formatted.clear();
+            for (const TokenSpan& t : spans)    write_token(formatted, t);
+        }));
+
+        results.push_back(measure(input, "write", options, [&]
+        {
+            int fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            if (fd < 0)    throw (errno);
+
+            OutputSink out {fd};
+            out.append(text.data(), text.size());
+            out.flush();
+            close(fd);
+        }));
+
+        results.push_back(measure(input, "total", options, [&]
+        {
+            int in  = open(input.path.c_str(), O_RDONLY);
+            int fd  = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            if (in < 0 || fd < 0)    throw (errno);
+
+            OutputSink out {fd};
+            lex_fd(in, IOOptions {}, out, [](auto& out, const TokenSpan& t) { TextSink {out}(t); });
+            out.flush();
+            close(fd);
+            close(in);
+        }));
+    }
+
+    filesystem::remove(output);
+    return results;
+}
+
+
+// One result per line, so that a baseline can be read back a line at a time
+void save_results (const string& path, const vector<Result>& results, const SuiteOptions& options)
+{
+    ofstream file {path};
+
+    file << "{\n  \"size\": " << options.size << ", \"reps\": " << options.reps << ",\n  \"results\": [\n"
+         << setprecision(9);
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+
+        file << "    {\"input\": \"" << r.input << "\", \"phase\": \"" << r.phase << "\", \"bytes\": " << r.bytes
+             << ", \"tokens\": " << r.tokens << ", \"p10\": " << r.p10 << ", \"median\": " << r.median
+             << ", \"p90\": " << r.p90 << "}" << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+
+    file << "  ]\n}\n";
+}
+
+
+// Reads back the results in a file written by save_results
+vector<Result> load_results (const string& path)
+{
+    ifstream file {path};
+    if (!file)    throw (errno);
+
+    auto field = [](const string& line, const string& key) -> string
+    {
+        size_t at = line.find("\"" + key + "\": ");
+        if (at == string::npos)    return {};
+
+        at += key.size() + 4;
+        if (line[at] == '"')    return line.substr(at + 1, line.find('"', at + 1) - at - 1);
+
+        return line.substr(at, line.find_first_of(",}", at) - at);
+    };
+
+    vector<Result> results;
+
+    for (string line; getline(file, line); )
+    {
+        if (field(line, "phase").empty())    continue;
+
+        results.push_back({field(line, "input"), field(line, "phase"),
+                           stoul(field(line, "bytes")), stoul(field(line, "tokens")),
+                           stod(field(line, "p10")), stod(field(line, "median")), stod(field(line, "p90"))});
+    }
+
+    if (results.empty())    throw runtime_error("no results");
+
+    return results;
+}
+
+
+void print_results (const vector<Result>& results)
+{
+    cout << "input        phase       MB/s   Mtokens/s     p10 ms  median ms     p90 ms\n" << fixed;
+
+    for (const Result& r : results)
+    {
+        cout << left << setw(13) << r.input << setw(8) << r.phase << right
+             << setprecision(1) << setw(9) << r.mb_per_second() << setw(12) << r.tokens_per_second() / 1e6
+             << setprecision(3) << setw(11) << r.p10 * 1e3 << setw(11) << r.median * 1e3 << setw(11) << r.p90 * 1e3
+             << '\n';
+    }
+}
+
+
+// Print each result against its baseline for the same input, by median throughput. Returns how many are slower by more
+// than threshold percent.
+int compare_results (const vector<Result>& baseline, const vector<Result>& results, double threshold)
+{
+    int regressions = 0;
+
+    cout << "\ninput        phase   baseline MB/s       MB/s    change\n" << fixed << setprecision(1);
+
+    for (const Result& r : results)
+    {
+        auto old = find_if(baseline.begin(), baseline.end(), [&](const Result& b)
+        {
+            return b.input == r.input && b.phase == r.phase && b.bytes == r.bytes;
+        });
+
+        if (old == baseline.end())    continue;
+
+        double change = 100 * (r.mb_per_second() / old->mb_per_second() - 1);
+
+        // Only a change wider than the spread of both runs is taken for a regression
+        bool noisy   = r.p90 >= old->p10 && old->p90 >= r.p10;
+        bool slower  = change < -threshold && !noisy;
+
+        regressions += slower;
+
+        cout << left << setw(13) << r.input << setw(8) << r.phase << right
+             << setw(15) << old->mb_per_second() << setw(11) << r.mb_per_second()
+             << setw(9) << showpos << change << noshowpos << " %" << (slower ? "    REGRESSION" : "") << '\n';
+    }
+
+    return regressions;
+}
+
+
+SuiteOptions parse_suite_args (int argc, char* argv[])
+{
+    SuiteOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+
+        if (i + 1 == argc)    throw invalid_argument("missing value for " + arg);
+
+        string value = argv[i + 1];
+
+        if      (arg == "--size")         options.size      = stoul(value) << 20;
+        else if (arg == "--seed")         options.seed      = stoull(value);
+        else if (arg == "--reps")         options.reps      = max(1, stoi(value));
+        else if (arg == "--warmup")       options.warmup    = stoi(value);
+        else if (arg == "--cpu")          options.cpu       = stoi(value);
+        else if (arg == "--save")         options.save      = value;
+        else if (arg == "--compare")      options.compare   = value;
+        else if (arg == "--threshold")    options.threshold = stod(value);
+        else                              throw invalid_argument("unknown option " + arg);
+
+        ++i;
+    }
+
+    return options;
+}
+
+
+int main (int argc, char* argv[])
+{
+    SuiteOptions options;
+
+    try
+    {
+        options = parse_suite_args(argc, argv);
+    }
+    catch (const exception& e)
+    {
+        cerr << "bench/suite: " << e.what() << '\n';
+        return 2;
+    }
+
+    // Read before the suite runs, so that a bad baseline isn't found only at the end
+    vector<Result> baseline;
+
+    try
+    {
+        if (!options.compare.empty())    baseline = load_results(options.compare);
+    }
+    catch (int error)
+    {
+        cerr << "bench/suite: " << options.compare << ": " << strerror(error) << '\n';
+        return 2;
+    }
+    catch (const exception& e)
+    {
+        cerr << "bench/suite: " << options.compare << ": not a saved baseline (" << e.what() << ")\n";
+        return 2;
+    }
+
+    if (options.cpu == -2)    options.cpu = sched_getcpu();
+
+    if (options.cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(options.cpu, &cpus);
+
+        if (sched_setaffinity(0, sizeof cpus, &cpus) != 0)    { perror("bench/suite: sched_setaffinity"); return 1; }
+    }
+
+    vector<Input> inputs {{"tests", ""}, {"corpus", ""}, {"generated", ""}};
+    auto          directory = filesystem::temp_directory_path();
+
+    for (Input& input : inputs)
+    {
+        CorpusOptions generated;
+        generated.seed = options.seed;
+
+        string source = (input.name == "tests")  ? make_corpus(1)
+                      : (input.name == "corpus") ? make_corpus(options.size)
+                      :                            generate_corpus(options.size, generated);
+
+        input.path  = (directory / ("lex-bench-suite-" + input.name + ".t")).string();
+        input.bytes = source.size();
+        Lexer {source.c_str()}.run([&](const TokenSpan&) { ++input.tokens; });
+
+        ofstream {input.path, ios::binary}.write(source.data(), source.size());
+    }
+
+    cout << "pinned to CPU " << options.cpu << ", " << options.warmup << " warm-up and " << options.reps
+         << " timed runs; MB/s and tokens/s are of input, at the median\n\n";
+
+    vector<Result> results = run_suite(inputs, options);
+
+    for (const Input& input : inputs)    filesystem::remove(input.path);
+
+    print_results(results);
+
+    if (!options.save.empty())    save_results(options.save, results, options);
+
+    if (!options.compare.empty())
+    {
+        int regressions = compare_results(baseline, results, options.threshold);
+
+        if (regressions)    { cout << regressions << " regressions\n"; return 1; }
+    }
+}
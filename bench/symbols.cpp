@@ -0,0 +1,59 @@
+// Interning identifiers: the memory their values take as strings against as symbols, and the cost of interning
+#include "bench.hpp"
+
+
+int main ()
+{
+    // A few hundred names, each repeated many times, as in generated programs
+    string corpus;
+
+    for (int i = 0; corpus.size() < (16 << 20); ++i)
+        corpus += "count_" + std::to_string(i * 7919 % 300) + " = total_" + std::to_string(i % 211) + " + 1;\n";
+
+    vector<CompactToken> tokens;
+    for (Lexer lexer {corpus.c_str()}; lexer.has_more(); )    tokens.push_back(lexer.next_compact());
+
+    size_t string_bytes = 0, identifiers = 0;
+
+    for (auto& t : tokens)
+        if (t.name == TokenName::IDENTIFIER)
+        {
+            ++identifiers;
+            string_bytes += sizeof (string) + (t.length > 15 ? t.length + 1 : 0);
+        }
+
+    SymbolTable symbols;
+
+    double time = best_seconds(5, [&]
+    {
+        symbols.clear();
+
+        Lexer lexer {corpus.c_str()};
+        lexer.intern_into(symbols);
+
+        while (lexer.has_more())    lexer.next_compact();
+    });
+
+    // Every symbol must name what it was interned from, and the IDs must be dense
+    Lexer lexer {corpus.c_str()};
+    SymbolTable check;
+    lexer.intern_into(check);
+
+    while (lexer.has_more())
+    {
+        CompactToken t = lexer.next_compact();
+
+        if (t.name == TokenName::IDENTIFIER
+            && (static_cast<size_t>(t.value) >= check.size()
+                || check.name(t.value) != string_view {corpus.c_str() + t.offset, t.length}))
+        {
+            cerr << "symbols: identifier at offset " << t.offset << " interned wrongly\n";
+            return 1;
+        }
+    }
+
+    cout << identifiers << " identifiers, " << symbols.size() << " distinct\n"
+         << "as strings      " << string_bytes    << " bytes\n"
+         << "as symbols      " << symbols.bytes() << " bytes\n"
+         << "lex and intern  " << fixed << setprecision(1) << corpus.size() / time / 1e6 << " MB/s\n";
+}
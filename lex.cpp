@@ -1,17 +1,48 @@
 // An implementation of the Rosetta Code Lexical Analyzer in C++
 // http://rosettacode.org/wiki/Compiler/lexical_analyzer
 
+#include <algorithm>     // std::lower_bound, std::max
+#include <array>         // token_labels
+#include <atomic>        // parallel_for
+#include <chrono>        // main
+#include <cerrno>        // errno
 #include <charconv>      // std::from_chars
-#include <fstream>       // file_to_string, string_to_file
-#include <functional>    // std::invoke
-#include <iomanip>       // std::setw
-#include <ios>           // std::left
+#include <cstdlib>       // std::strtol
+#include <cstring>       // std::memcpy, std::memmove, std::memset, std::strerror
+#include <coroutine>     // TokenGenerator
+#include <deque>         // work_stealing_for
+#include <exception>     // TokenGenerator, ChunkRun
+#include <filesystem>    // expand_paths, lex_batch
+#include <initializer_list> // char_class_is
+#include <iomanip>       // std::setprecision
 #include <iostream>
-#include <map>           // keywords
+#include <iterator>      // BasicTokenRange
+#include <memory>        // OutputSink, SymbolTable
+#include <mutex>         // work_stealing_for, lex_batch
+#include <numeric>       // std::partial_sum
+#include <optional>      // ChunkRun
+#include <ranges>        // BasicTokenRange
 #include <sstream>
+#include <stdexcept>     // std::invalid_argument, std::runtime_error
 #include <string>
+#include <string_view>
+#include <unordered_map> // TokenStreamWriter
+#include <thread>        // parallel_for
+#include <tuple>         // OperatorDFA
 #include <utility>       // std::forward
 #include <variant>       // TokenVal
+#include <vector>        // StreamBuffer
+
+#if defined(__SSE2__)
+#include <immintrin.h>   // find_escape
+#endif
+
+#include <fcntl.h>       // open
+#include <glob.h>        // expand_paths
+#include <sys/mman.h>    // mmap, madvise
+#include <sys/stat.h>    // fstat
+#include <sys/uio.h>     // writev
+#include <unistd.h>      // close, read, write, sysconf
 
 using namespace std;
 
@@ -19,371 +50,2977 @@ using namespace std;
 // =====================================================================================================================
 // Machinery
 // =====================================================================================================================
-string file_to_string (const string& path)
+// A read-only file mapped straight into memory, so the Lexer can scan it in place without copying it into a string.
+// The mapping is always followed by at least one '\0' byte, which the Scanner relies on as its end-of-input sentinel.
+class MappedFile
 {
-    // Open file
-    ifstream file {path, ios::in | ios::binary | ios::ate};
-    if (!file)   throw (errno);
+public:
+    struct Options
+    {
+        bool populate   = false;    // MAP_POPULATE: fault in every page up front
+        bool sequential = false;    // madvise(MADV_SEQUENTIAL): aggressive read-ahead, pages may be dropped behind us
+    };
 
-    // Allocate string memory
-    string contents;
-    contents.resize(file.tellg());
+    MappedFile (int fd, Options options)
+    {
+        struct stat info;
+        if (fstat(fd, &info) != 0)    throw (errno);
 
-    // Read file contents into string
-    file.seekg(0);
-    file.read(contents.data(), contents.size());
+        size = info.st_size;
+        if (size == 0)    return;
 
-    return contents;
-}
+        // Reserve room for the file rounded up to whole pages plus one more, then map the file over the front of it.
+        // The tail of the file's last page is zero-filled by the kernel, and a full page of zeros always follows it, so
+        // lookahead past the sentinel stays inside the mapping.
+        size_t page = sysconf(_SC_PAGESIZE);
+        length = (size + page - 1) / page * page + page;
 
+        void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)    throw (errno);
 
-void string_to_file (const string& path, string contents)
-{
-    ofstream file {path, ios::out | ios::binary};
-    if (!file)    throw (errno);
+        int flags = MAP_PRIVATE | MAP_FIXED | (options.populate ? MAP_POPULATE : 0);
 
-    file.write(contents.data(), contents.size());
-}
+        if (mmap(base, size, PROT_READ, flags, fd, 0) == MAP_FAILED)
+        {
+            int error = errno;
+            munmap(base, length);
+            throw (error);
+        }
 
+        if (options.sequential)    madvise(base, size, MADV_SEQUENTIAL);
 
-template <class F>
-void with_IO (string source, string destination, F&& f)
-{
-    string input;
+        data = static_cast<const char*>(base);
+    }
 
-    if (source == "stdin")    getline(cin, input);
-    else                      input = file_to_string(source);
+    MappedFile (const MappedFile&) = delete;
+    MappedFile& operator= (const MappedFile&) = delete;
 
-    string output = invoke(forward<F>(f), input);
+    ~MappedFile ()    { if (length)    munmap(const_cast<char*>(data), length); }
 
-    if (destination == "stdout")    cout << output;
-    else                            string_to_file(destination, output);
-}
+    string_view view () const    { return {data, size}; }
+
+    // Drop the whole pages before p from memory, so a front-to-back pass keeps a bounded resident set. They fault back
+    // in from the file should they be read again.
+    void release (const char* p)
+    {
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t upto = (p - data) / page * page;
 
+        if (upto > released)    madvise(const_cast<char*>(data) + released, upto - released, MADV_DONTNEED);
 
-// Add escaped newlines and backslashes back in for printing
-string sanitize (string s)
-{
-    for (int i = 0; i < s.size(); ++i)
+        released = max(released, upto);
+    }
+
+    static bool can_map (int fd)
     {
-        if      (s[i] == '\n')    s.replace(i++, 1, "\\n");
-        else if (s[i] == '\\')    s.replace(i++, 1, "\\\\");
+        struct stat info;
+        return fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
     }
 
-    return s;
-}
+private:
+    const char* data     = "";
+    size_t      size     = 0;
+    size_t      length   = 0;
+    size_t      released = 0;
+}; // class MappedFile
 
 
-class Scanner
+// A reusable, growing byte buffer that output is formatted into. Once it has grown to fit, writing costs no
+// allocations.
+class OutputBuffer
 {
 public:
-    const char* pos;
-    int         line   = 1;
-    int         column = 1;
+    // Room for at least n more bytes. Write into it, then commit() the end of what was written.
+    char* reserve (size_t n)
+    {
+        if (storage.size() - used < n)    storage.resize(max(2 * storage.size(), used + n));
+        return storage.data() + used;
+    }
 
-    Scanner (const char* source) : pos {source} {}
+    void commit (char* end)    { used = end - storage.data(); }
 
-    inline char peek ()    { return *pos; }
+    void append (const char* data, size_t n)    { memcpy(reserve(n), data, n); used += n; }
+    void append (string_view s)                 { append(s.data(), s.size()); }
 
-    void advance ()
+    const char* data  () const    { return storage.data(); }
+    size_t      size  () const    { return used; }
+    void        clear ()          { used = 0; }
+
+    void truncate (size_t n)    { used = min(used, n); }
+
+    // Nothing to hand on; lets an OutputBuffer stand in for an OutputSink
+    void flush ()    {}
+
+private:
+    string storage;
+    size_t used = 0;
+}; // class OutputBuffer
+
+
+// Buffered output straight to a file descriptor. Output is collected in a fixed-size buffer and handed to the kernel
+// with write(2) when it fills; appends that don't fit are written together with the buffer by writev(2), so large
+// values are never copied. Memory use stays the same however much is written. Anything still buffered when the sink
+// is destroyed is lost unless flush() was called.
+//
+// Pipes are written to like anything else. vmsplice(2) would save the copy, but a reader that splices the data onward
+// keeps referring to our pages, so the buffer could never safely be filled again.
+class OutputSink
+{
+public:
+    explicit OutputSink (int fd, size_t capacity = 64 * 1024)
+        : fd {fd}, capacity {capacity}, buffer {make_unique<char[]>(capacity)} {}
+
+    OutputSink (const OutputSink&) = delete;
+    OutputSink& operator= (const OutputSink&) = delete;
+
+    // Room for at least n more bytes, n being no more than the capacity. Write into it, then commit() the end of what
+    // was written.
+    char* reserve (size_t n)
     {
-        if (*pos == '\n')    { ++line; column = 1; }
-        else                 ++column;
+        if (capacity - used < n)    flush();
+        return buffer.get() + used;
+    }
 
-        ++pos;
+    void commit (char* end)    { used = end - buffer.get(); }
+
+    void append (const char* data, size_t n)
+    {
+        if (n <= capacity - used)
+        {
+            memcpy(buffer.get() + used, data, n);
+            used += n;
+        }
+        else
+        {
+            iovec parts[] = {{buffer.get(), used}, {const_cast<char*>(data), n}};
+            write_all(parts, 2);
+            used = 0;
+        }
     }
 
-    char next ()
+    void append (string_view s)    { append(s.data(), s.size()); }
+
+    // Hand everything buffered to the kernel
+    void flush ()
     {
-        advance();
-        return peek();
+        iovec part = {buffer.get(), used};
+        write_all(&part, 1);
+        used = 0;
     }
 
-    void skip_whitespace ()
+private:
+    int                fd;
+    size_t             capacity;
+    unique_ptr<char[]> buffer;
+    size_t             used = 0;
+
+    void write_all (iovec* parts, int count)
     {
-        while (isspace(static_cast<unsigned char>(peek())))
-            advance();
+        while (count > 0)
+        {
+            ssize_t n = writev(fd, parts, count);
+
+            if (n < 0 && errno == EINTR)    continue;
+            if (n < 0)                      throw (errno);
+
+            for (; count > 0 && size_t(n) >= parts->iov_len; --count, ++parts)    n -= parts->iov_len;
+
+            if (count > 0)
+            {
+                parts->iov_base = static_cast<char*>(parts->iov_base) + n;
+                parts->iov_len -= n;
+            }
+        }
     }
-}; // class Scanner
+}; // class OutputSink
 
 
-// =====================================================================================================================
-// Tokens
-// =====================================================================================================================
-enum class TokenName
+// What each byte can be to the lexer, as flags in char_class
+struct CharClass
 {
-    OP_MULTIPLY, OP_DIVIDE, OP_MOD, OP_ADD, OP_SUBTRACT, OP_NEGATE,
-    OP_LESS, OP_LESSEQUAL, OP_GREATER, OP_GREATEREQUAL, OP_EQUAL, OP_NOTEQUAL,
-    OP_NOT, OP_ASSIGN, OP_AND, OP_OR,
-    LEFTPAREN, RIGHTPAREN, LEFTBRACE, RIGHTBRACE, SEMICOLON, COMMA,
-    KEYWORD_IF, KEYWORD_ELSE, KEYWORD_WHILE, KEYWORD_PRINT, KEYWORD_PUTC,
-    IDENTIFIER, INTEGER, STRING,
-    END_OF_INPUT, ERROR
+    enum : uint8_t { SPACE = 1, ID_START = 2, ID_CONTINUE = 4, DIGIT = 8, OPERATOR = 16, QUOTE = 32 };
 };
 
-using TokenVal = variant<int, string>;
-
-struct Token
+// The class of every byte, built at compile time from ASCII alone so that lexing never depends on the process locale.
+// The Scanner, the Lexer and the table-driven engine all classify bytes with it, and the vectorised scanners are
+// checked against it below.
+inline constexpr array<uint8_t, 256> char_class = []
 {
-    TokenName name;
-    TokenVal  value;
-    int       line;
-    int       column;
-};
+    array<uint8_t, 256> classes {};
 
+    for (int c : {' ', '\t', '\n', '\v', '\f', '\r'})    classes[c] |= CharClass::SPACE;
 
-const char* to_cstring (TokenName name)
-{
-    static const char* s[] =
+    for (int c = 'a'; c <= 'z'; ++c)
     {
-        "Op_multiply", "Op_divide", "Op_mod", "Op_add", "Op_subtract", "Op_negate",
-        "Op_less", "Op_lessequal", "Op_greater", "Op_greaterequal", "Op_equal", "Op_notequal",
-        "Op_not", "Op_assign", "Op_and", "Op_or",
-        "LeftParen", "RightParen", "LeftBrace", "RightBrace", "Semicolon", "Comma",
-        "Keyword_if", "Keyword_else", "Keyword_while", "Keyword_print", "Keyword_putc",
-        "Identifier", "Integer", "String",
-        "End_of_input", "Error"
-    };
+        classes[c]             |= CharClass::ID_START | CharClass::ID_CONTINUE;
+        classes[c - 'a' + 'A'] |= CharClass::ID_START | CharClass::ID_CONTINUE;
+    }
 
-    return s[static_cast<int>(name)];
-}
+    for (int c = '0'; c <= '9'; ++c)    classes[c] |= CharClass::DIGIT | CharClass::ID_CONTINUE;
 
+    classes['_'] |= CharClass::ID_START | CharClass::ID_CONTINUE;
 
-string to_string (Token t)
+    for (char c : string_view {"*/%+-<>=!&|(){};,"})    classes[static_cast<unsigned char>(c)] |= CharClass::OPERATOR;
+
+    classes['\''] |= CharClass::QUOTE;
+    classes['"']  |= CharClass::QUOTE;
+
+    return classes;
+}();
+
+inline bool has_class (char c, uint8_t classes)    { return char_class[static_cast<unsigned char>(c)] & classes; }
+
+
+// Offset of the first newline or backslash in p[0, n), or n if there is none. Compares a whole vector of bytes per
+// step and only looks at single bytes for the tail.
+inline size_t find_escape (const char* p, size_t n)
 {
-    ostringstream out;
-    out << setw(2) << t.line << "   " << setw(2) << t.column  << "   ";
+    size_t i = 0;
 
-    switch (t.name)
+#if defined(__AVX2__)
+    const __m256i newline32   = _mm256_set1_epi8('\n');
+    const __m256i backslash32 = _mm256_set1_epi8('\\');
+
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i  v    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        unsigned hits = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, newline32),
+                                                             _mm256_cmpeq_epi8(v, backslash32)));
+        if (hits)    return i + __builtin_ctz(hits);
+    }
+#endif
+
+#if defined(__SSE2__)
+    const __m128i newline   = _mm_set1_epi8('\n');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    for (; i + 16 <= n; i += 16)
     {
-        case (TokenName::IDENTIFIER)   : out << "Identifier        "   << get<string>(t.value);                  break;
-        case (TokenName::INTEGER)      : out << "Integer           "   << left << get<int>(t.value);             break;
-        case (TokenName::STRING)       : out << "String            \"" << sanitize(get<string>(t.value)) << '"'; break;
-        case (TokenName::END_OF_INPUT) : out << "End_of_input";                                                  break;
-        case (TokenName::ERROR)        : out << "Error             "   << get<string>(t.value);                  break;
-        default                        : out << to_cstring(t.name);
+        __m128i  v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        unsigned hits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, newline), _mm_cmpeq_epi8(v, backslash)));
+        if (hits)    return i + __builtin_ctz(hits);
     }
+#endif
 
-    out << '\n';
+    for (; i < n; ++i)
+        if (p[i] == '\n' || p[i] == '\\')    return i;
 
-    return out.str();
+    return n;
 }
 
 
-// =====================================================================================================================
-// Lexer
-// =====================================================================================================================
-class Lexer
+// Number of newlines in p[0, n)
+inline size_t count_newlines (const char* p, size_t n)
 {
-public:
-    Lexer (const char* source) : s {source}, pre_state {s} {}
+    size_t count = 0;
+    size_t i     = 0;
 
-    bool has_more ()    { return s.peek() != '\0'; }
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
 
-    Token next_token ()
+    for (; i + 16 <= n; i += 16)
     {
-        s.skip_whitespace();
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)));
+    }
+#endif
 
-        pre_state = s;
+    for (; i < n; ++i)    count += (p[i] == '\n');
 
-        switch (s.peek())
-        {
-            case '*'  :    return simply(TokenName::OP_MULTIPLY);
-            case '%'  :    return simply(TokenName::OP_MOD);
-            case '+'  :    return simply(TokenName::OP_ADD);
-            case '-'  :    return simply(TokenName::OP_SUBTRACT);
-            case '{'  :    return simply(TokenName::LEFTBRACE);
-            case '}'  :    return simply(TokenName::RIGHTBRACE);
-            case '('  :    return simply(TokenName::LEFTPAREN);
-            case ')'  :    return simply(TokenName::RIGHTPAREN);
-            case ';'  :    return simply(TokenName::SEMICOLON);
-            case ','  :    return simply(TokenName::COMMA);
-            case '&'  :    return expect('&', TokenName::OP_AND);
-            case '|'  :    return expect('|', TokenName::OP_OR);
-            case '<'  :    return follow('=', TokenName::OP_LESSEQUAL,    TokenName::OP_LESS);
-            case '>'  :    return follow('=', TokenName::OP_GREATEREQUAL, TokenName::OP_GREATER);
-            case '='  :    return follow('=', TokenName::OP_EQUAL,        TokenName::OP_ASSIGN);
-            case '!'  :    return follow('=', TokenName::OP_NOTEQUAL,     TokenName::OP_NOT);
-            case '/'  :    return divide_or_comment();
-            case '\'' :    return char_lit();
-            case '"'  :    return string_lit();
+    return count;
+}
 
-            default   :    if (is_id_start(s.peek()))    return identifier();
-                           if (is_digit(s.peek()))       return integer_lit();
-                           return error("Unrecognized character '", s.peek(), "'");
 
-            case '\0' :    return make_token(TokenName::END_OF_INPUT);
-        }
+// Whether the bytes in char_class with any of the given classes are exactly those within the ranges [first, last]. The
+// vector masks below test ranges rather than look bytes up, and this keeps them in step with the table.
+constexpr bool char_class_is (uint8_t classes, initializer_list<pair<int, int>> ranges)
+{
+    for (int c = 0; c < 256; ++c)
+    {
+        bool in_range = false;
+        for (auto [first, last] : ranges)    in_range |= (c >= first && c <= last);
+
+        if (in_range != ((char_class[c] & classes) != 0))    return false;
     }
 
+    return true;
+}
 
-private:
-    Scanner s;
-    Scanner pre_state;
-    static const map<string, TokenName> keywords;
+static_assert(char_class_is(CharClass::SPACE,       {{'\t', '\r'}, {' ', ' '}}));
+static_assert(char_class_is(CharClass::ID_CONTINUE, {{'a', 'z'}, {'A', 'Z'}, {'0', '9'}, {'_', '_'}}));
 
 
-    template <class... Args>
-    Token error (Args&&... ostream_args)
-    {
-        string code {pre_state.pos, (string::size_type) s.column - pre_state.column};
+#if defined(__SSE2__)
+// Masks of the bytes in v that are whitespace, and of those that can continue an identifier. Ranges are tested by
+// shifting them down to start at 0 and comparing unsigned.
+inline unsigned space_mask (__m128i v)
+{
+    __m128i control = _mm_sub_epi8(v, _mm_set1_epi8('\t'));    // \t \n \v \f \r
+    __m128i space   = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8(4)), control),
+                                   _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    return _mm_movemask_epi8(space);
+}
 
-        ostringstream msg;
-        (msg << ... << forward<Args>(ostream_args)) << '\n'
-            << string(28, ' ') << "(" << s.line << ", " << s.column << "): " << code;
+inline unsigned word_mask (__m128i v)
+{
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i digit  = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i word   = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(25)), letter),
+                                               _mm_cmpeq_epi8(_mm_min_epu8(digit,  _mm_set1_epi8(9)),  digit)),
+                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    return _mm_movemask_epi8(word);
+}
 
-        if (s.peek() != '\0')    s.advance();
+inline unsigned string_mask (__m128i v)
+{
+    __m128i stop = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                             _mm_cmpeq_epi8(v, _mm_setzero_si128())));
+    return ~_mm_movemask_epi8(stop);
+}
 
-        return make_token(TokenName::ERROR, msg.str());
-    }
+inline unsigned comment_mask (__m128i v)
+{
+    __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('*')), _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    return ~_mm_movemask_epi8(stop);
+}
 
 
-    inline Token make_token (TokenName name, TokenVal value = 0)
-    {
-        return {name, value, pre_state.line, pre_state.column};
-    }
+// End of the run of bytes from p that Mask matches. The run is read a 16-byte aligned block at a time and its end found
+// with ctz. An aligned block never straddles a page, so it is safe to read the rest of the block holding the '\0' that
+// ends the input, and the run ends at that '\0' at the latest.
+template <unsigned (*Mask) (__m128i)>
+inline const char* end_of_run (const char* p)
+{
+    auto     offset = reinterpret_cast<uintptr_t>(p) & 15;
+    auto     block  = reinterpret_cast<const __m128i*>(p - offset);
+    unsigned others = (~Mask(_mm_load_si128(block)) & 0xFFFF) >> offset << offset;
 
+    while (others == 0)    others = ~Mask(_mm_load_si128(++block)) & 0xFFFF;
 
-    Token simply (TokenName name)
-    {
-        s.advance();
-        return make_token(name);
-    }
+    return reinterpret_cast<const char*>(block) + __builtin_ctz(others);
+}
+#endif
+
+
+// End of the whitespace starting at p
+inline const char* skip_spaces (const char* p)
+{
+#if defined(__SSE2__)
+    return end_of_run<space_mask>(p);
+#else
+    while (has_class(*p, CharClass::SPACE))    ++p;
+    return p;
+#endif
+}
+
+
+// End of the identifier characters starting at p
+inline const char* skip_word (const char* p)
+{
+#if defined(__SSE2__)
+    return end_of_run<word_mask>(p);
+#else
+    while (has_class(*p, CharClass::ID_CONTINUE))    ++p;
+    return p;
+#endif
+}
+
+
+// The first character from p that ends a clean run of string literal text: a quote, backslash, newline or '\0'
+inline const char* skip_string_text (const char* p)
+{
+#if defined(__SSE2__)
+    return end_of_run<string_mask>(p);
+#else
+    while (*p != '"' && *p != '\\' && *p != '\n' && *p != '\0')    ++p;
+    return p;
+#endif
+}
 
 
-    Token expect (char expected, TokenName name)
+// Where the block comment whose text starts at p ends: just past its closing "*/", or at the '\0' ending the input if
+// it is never closed, as the second member tells. Only the '*'s need looking at, and they are found a vector at a time.
+// A '*' not followed by '/' hides the character after it, so "**/" does not close a comment.
+inline pair<const char*, bool> comment_end (const char* p)
+{
+    while (true)
     {
-        return s.next() == expected ? simply(name) : error("Unrecognized character '", s.peek(), "'");
+#if defined(__SSE2__)
+        p = end_of_run<comment_mask>(p);
+#else
+        while (*p != '*' && *p != '\0')    ++p;
+#endif
+
+        if (*p == '\0')     return {p, false};
+        if (p[1] == '/')    return {p + 2, true};
+        if (p[1] == '\0')   return {p + 1, false};
+
+        p += 2;
     }
+}
 
 
-    Token follow (char expected, TokenName ifyes, TokenName ifno)
+// As comment_end, but looking no further than limit, which must not be past the '\0' ending the input. Unless its "*/"
+// starts before limit, the comment is taken as not closed and limit is returned.
+inline pair<const char*, bool> comment_end (const char* p, const char* limit)
+{
+    while (p < limit)
     {
-        return s.next() == expected ? simply(ifyes) : make_token(ifno);
+        auto star = static_cast<const char*>(memchr(p, '*', limit - p));
+
+        if (!star)             break;
+        if (star[1] == '/')    return {star + 2, true};
+
+        p = star + 2;
     }
 
+    return {limit, false};
+}
+
 
-    Token divide_or_comment ()
+// Append s to out with newlines and backslashes escaped back in for printing. The runs between escapes are appended
+// whole, so this is a single linear pass however many escapes there are.
+template <class Out>
+void write_escaped (Out& out, string_view s)
+{
+    const char* p = s.data();
+    size_t      n = s.size();
+
+    while (true)
     {
-        if (s.next() != '*')    return make_token(TokenName::OP_DIVIDE);
+        size_t run = find_escape(p, n);
+        out.append(p, run);
 
-        while (s.next() != '\0')
-            if (s.peek() == '*' && s.next() == '/')
-            {
-                s.advance();
-                return next_token();
-            }
+        if (run == n)    return;
 
-        return error("End-of-file in comment. Closing comment characters not found.");
+        out.append(p[run] == '\n' ? "\\n" : "\\\\", 2);
+        p += run + 1;
+        n -= run + 1;
     }
+}
 
 
-    Token char_lit ()
-    {
-        int n = s.next();
+string sanitize (string_view s)
+{
+    OutputBuffer out;
+    write_escaped(out, s);
 
-        if (n == '\'')    return error("Empty character constant");
+    return {out.data(), out.size()};
+}
 
-        if (n == '\\')    switch (s.next())
-                          {
-                              case 'n'  :    n = '\n'; break;
-                              case '\\' :    n = '\\'; break;
-                              default   :    return error("Unknown escape sequence \\", s.peek());
-                          }
 
-        if (s.next() != '\'')    return error("Multi-character constant");
+// The inverse of sanitize(): decode the \n and \\ escapes a string literal may contain. The runs between escapes are
+// appended whole.
+string unescape (string_view s)
+{
+    string text;
+    text.reserve(s.size());
 
-        s.advance();
-        return make_token(TokenName::INTEGER, n);
+    size_t i = 0;
+
+    for (size_t hit; (hit = s.find('\\', i)) != string_view::npos && hit + 1 < s.size(); i = hit + 2)
+    {
+        text.append(s.data() + i, hit - i);
+        text += s[hit + 1] == 'n' ? '\n' : s[hit + 1];
     }
 
+    text.append(s.data() + i, s.size() - i);
+
+    return text;
+}
+
+
+// Interns names, giving each distinct one a dense ID counting up from 0, so that later stages can compare them as
+// integers. The text of each name is copied once into an arena, which makes memory grow with the number of distinct
+// names rather than with how often they occur. Lookups probe an open-addressed table of hashes and IDs.
+class SymbolTable
+{
+public:
+    static constexpr uint32_t none = UINT32_MAX;
 
-    Token string_lit ()
+    uint32_t intern (string_view name)
     {
-        string text = "";
+        if (2 * (names.size() + 1) > slots.size())    grow();
+
+        uint32_t h = hash(name);
+
+        for (size_t i = h & (slots.size() - 1); ; i = (i + 1) & (slots.size() - 1))
+        {
+            Slot& slot = slots[i];
 
-        while (s.next() != '"')
-            switch (s.peek())
+            if (slot.id == none)
             {
-                case '\\' :    switch (s.next())
-                               {
-                                   case 'n'  :    text += '\n'; continue;
-                                   case '\\' :    text += '\\'; continue;
-                                   default   :    return error("Unknown escape sequence \\", s.peek());
-                               }
+                slot = {h, static_cast<uint32_t>(names.size())};
+                names.push_back(store(name));
+                return slot.id;
+            }
+
+            if (slot.hash == h && names[slot.id] == name)    return slot.id;
+        }
+    }
 
-                case '\n' :    return error("End-of-line while scanning string literal."
-                                            " Closing string character not found before end-of-line.");
+    // The ID of name, or none if it has not been interned
+    uint32_t find (string_view name) const
+    {
+        if (slots.empty())    return none;
 
-                case '\0' :    return error("End-of-file while scanning string literal."
-                                            " Closing string character not found.");
+        uint32_t h = hash(name);
 
-                default   :    text += s.peek();
-            }
+        for (size_t i = h & (slots.size() - 1); slots[i].id != none; i = (i + 1) & (slots.size() - 1))
+            if (slots[i].hash == h && names[slots[i].id] == name)    return slots[i].id;
 
-        s.advance();
-        return make_token(TokenName::STRING, text);
+        return none;
+    }
+
+    string_view name (uint32_t id) const    { return names[id]; }
+    size_t      size ()             const    { return names.size(); }
+
+    // Memory held for the table, its names and their text
+    size_t bytes () const
+    {
+        return slots.capacity() * sizeof (Slot) + names.capacity() * sizeof (string_view) + arena_bytes;
     }
 
+    void clear ()
+    {
+        slots.clear(); names.clear(); blocks.clear();
+        free_begin  = free_end = nullptr;
+        arena_bytes = 0;
+    }
 
-    static inline bool is_id_start (char c)    { return isalpha(static_cast<unsigned char>(c)) || c == '_'; }
-    static inline bool is_id_end   (char c)    { return isalnum(static_cast<unsigned char>(c)) || c == '_'; }
-    static inline bool is_digit    (char c)    { return isdigit(static_cast<unsigned char>(c));             }
 
+private:
+    static constexpr size_t block_size = 64 * 1024;
 
-    Token identifier ()
+    struct Slot
     {
-        string text (1, s.peek());
+        uint32_t hash;
+        uint32_t id = none;
+    };
+
+    vector<Slot>               slots;     // a power of two in size, and never more than half full
+    vector<string_view>        names;     // by ID, into blocks
+    vector<unique_ptr<char[]>> blocks;
+    char*                      free_begin  = nullptr;
+    char*                      free_end    = nullptr;
+    size_t                     arena_bytes = 0;
 
-        while (is_id_end(s.next()))    text += s.peek();
 
-        auto i = keywords.find(text);
-        if (i != keywords.end())    return make_token(i->second);
+    // FNV-1a
+    static uint32_t hash (string_view name)
+    {
+        uint32_t h = 2166136261u;
+
+        for (unsigned char c : name)    h = (h ^ c) * 16777619u;
 
-        return make_token(TokenName::IDENTIFIER, text);
+        return h;
     }
 
 
-    Token integer_lit ()
+    string_view store (string_view name)
     {
-        while (is_digit(s.next()));
+        if (name.size() > static_cast<size_t>(free_end - free_begin))
+        {
+            size_t size = max(block_size, name.size());
 
-        if (is_id_start(s.peek()))
-            return error("Invalid number. Starts like a number, but ends in non-numeric characters.");
+            blocks.push_back(make_unique<char[]>(size));
+            arena_bytes += size;
+            free_begin   = blocks.back().get();
+            free_end     = free_begin + size;
+        }
 
-        int n;
+        char* text = free_begin;
+        free_begin = copy(name.begin(), name.end(), free_begin);
 
-        auto r = from_chars(pre_state.pos, s.pos, n);
-        if (r.ec == errc::result_out_of_range)    return error("Number exceeds maximum value");
+        return {text, name.size()};
+    }
 
-        return make_token(TokenName::INTEGER, n);
+
+    void grow ()
+    {
+        vector<Slot> old = move(slots);
+        slots.assign(max<size_t>(64, 2 * old.size()), Slot {});
+
+        for (const Slot& slot : old)
+            if (slot.id != none)
+            {
+                size_t i = slot.hash & (slots.size() - 1);
+                while (slots[i].id != none)    i = (i + 1) & (slots.size() - 1);
+                slots[i] = slot;
+            }
     }
-}; // class Lexer
+}; // class SymbolTable
 
 
-const map<string, TokenName> Lexer::keywords =
+// A position in the source. With Lines false only the pointer moves and line and column stay at 1, for lexing to
+// offsets whose positions are worked out later from a LineIndex.
+template <bool Lines = true>
+class BasicScanner
 {
-    {"else",  TokenName::KEYWORD_ELSE},
-    {"if",    TokenName::KEYWORD_IF},
-    {"print", TokenName::KEYWORD_PRINT},
-    {"putc",  TokenName::KEYWORD_PUTC},
-    {"while", TokenName::KEYWORD_WHILE}
-};
+public:
+    const char* pos;
+    int         line   = 1;
+    int         column = 1;
 
+    BasicScanner (const char* source) : pos {source} {}
 
-int main (int argc, char* argv[])
-{
-    string in  = (argc > 1) ? argv[1] : "stdin";
-    string out = (argc > 2) ? argv[2] : "stdout";
+    inline char peek ()    { return *pos; }
 
-    with_IO(in, out, [](string input)
+    void advance ()
     {
-        Lexer lexer {input.data()};
+        if constexpr (Lines)
+        {
+            if (*pos == '\n')    { ++line; column = 1; }
+            else                 ++column;
+        }
 
-        string s = "Location  Token name        Value\n"
-                   "--------------------------------------\n";
+        ++pos;
+    }
 
-        while (lexer.has_more())    s += to_string(lexer.next_token());
-        return s;
-    });
+    char next ()
+    {
+        advance();
+        return peek();
+    }
+
+    // Step to end, with no newline before it
+    void skip_to (const char* end)
+    {
+        if constexpr (Lines)    column += static_cast<int>(end - pos);
+
+        pos = end;
+    }
+
+    void skip_whitespace ()
+    {
+        if (has_class(peek(), CharClass::SPACE))    advance_to(skip_spaces(pos));
+    }
+
+    // Step to end, counting the lines on the way in bulk
+    void advance_to (const char* end)
+    {
+        if constexpr (Lines)
+        {
+            if (size_t lines = count_newlines(pos, end - pos))
+            {
+                const char* last = end;
+                while (*--last != '\n');
+
+                line  += static_cast<int>(lines);
+                column = static_cast<int>(end - last);
+            }
+            else
+            {
+                column += static_cast<int>(end - pos);
+            }
+        }
+
+        pos = end;
+    }
+}; // class BasicScanner
+
+using Scanner       = BasicScanner<true>;
+using OffsetScanner = BasicScanner<false>;
+
+
+// The offset each line of the source starts at, found in one vectorised pass, from which the line and column of any
+// offset can be worked out by binary search. Lexing to offsets and resolving positions only where they are wanted saves
+// the Scanner counting them byte by byte.
+class LineIndex
+{
+public:
+    LineIndex (string_view source) : starts {0}
+    {
+        const char* p = source.data();
+        size_t      i = 0;
+
+#if defined(__SSE2__)
+        const __m128i newline = _mm_set1_epi8('\n');
+
+        for (; i + 16 <= source.size(); i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+
+            for (unsigned hits = _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)); hits; hits &= hits - 1)
+                starts.push_back(static_cast<uint32_t>(i + __builtin_ctz(hits) + 1));
+        }
+#endif
+
+        for (; i < source.size(); ++i)
+            if (p[i] == '\n')    starts.push_back(static_cast<uint32_t>(i + 1));
+    }
+
+    size_t lines () const    { return starts.size(); }
+
+    // Line and column of offset, both counting from 1 as the Scanner's do
+    pair<int, int> position (uint32_t offset) const
+    {
+        size_t line = upper_bound(starts.begin(), starts.end(), offset) - starts.begin();
+        return {static_cast<int>(line), static_cast<int>(offset - starts[line - 1] + 1)};
+    }
+
+
+private:
+    friend class LineCursor;
+
+    vector<uint32_t> starts;
+}; // class LineIndex
+
+
+// Positions for offsets that never decrease, as through a token stream: the line is found by stepping forward from the
+// last one rather than by searching
+class LineCursor
+{
+public:
+    LineCursor (const LineIndex& index) : starts {index.starts} {}
+
+    pair<int, int> position (uint32_t offset)
+    {
+        while (line < starts.size() && starts[line] <= offset)    ++line;
+
+        return {static_cast<int>(line), static_cast<int>(offset - starts[line - 1] + 1)};
+    }
+
+
+private:
+    const vector<uint32_t>& starts;
+    size_t                  line = 1;    // starts[line - 1] is the start of the current line
+}; // class LineCursor
+
+
+// =====================================================================================================================
+// Tokens
+// =====================================================================================================================
+enum class TokenName : uint8_t
+{
+    OP_MULTIPLY, OP_DIVIDE, OP_MOD, OP_ADD, OP_SUBTRACT, OP_NEGATE,
+    OP_LESS, OP_LESSEQUAL, OP_GREATER, OP_GREATEREQUAL, OP_EQUAL, OP_NOTEQUAL,
+    OP_NOT, OP_ASSIGN, OP_AND, OP_OR,
+    LEFTPAREN, RIGHTPAREN, LEFTBRACE, RIGHTBRACE, SEMICOLON, COMMA,
+    KEYWORD_IF, KEYWORD_ELSE, KEYWORD_WHILE, KEYWORD_PRINT, KEYWORD_PUTC,
+    IDENTIFIER, INTEGER, STRING,
+    END_OF_INPUT, ERROR
+};
+
+using TokenVal = variant<int, string>;
+
+struct Token
+{
+    TokenName name;
+    TokenVal  value;
+    int       line;
+    int       column;
+};
+
+
+// What went wrong, for an Error held as a CompactToken
+enum class LexError : int32_t
+{
+    UNRECOGNIZED_CHARACTER, EOF_IN_COMMENT, EMPTY_CHARACTER, UNKNOWN_ESCAPE, MULTI_CHARACTER,
+    EOL_IN_STRING, EOF_IN_STRING, INVALID_NUMBER, NUMBER_TOO_LARGE
+};
+
+// A token as the span of source it was lexed from, which takes no allocation to make. Integers keep their value,
+// Errors their LexError and Identifiers their symbol when the lexer interns them; the values of other tokens are read
+// from the span when it is converted to a Token. An Error's span is the code its message quotes, which ends at the
+// offending character.
+struct CompactToken
+{
+    TokenName name;
+    uint32_t  offset;    // from the start of the source
+    uint32_t  length;
+    int32_t   value;
+};
+
+static_assert(sizeof (CompactToken) == 16);
+
+
+const char* to_cstring (TokenName name)
+{
+    static const char* s[] =
+    {
+        "Op_multiply", "Op_divide", "Op_mod", "Op_add", "Op_subtract", "Op_negate",
+        "Op_less", "Op_lessequal", "Op_greater", "Op_greaterequal", "Op_equal", "Op_notequal",
+        "Op_not", "Op_assign", "Op_and", "Op_or",
+        "LeftParen", "RightParen", "LeftBrace", "RightBrace", "Semicolon", "Comma",
+        "Keyword_if", "Keyword_else", "Keyword_while", "Keyword_print", "Keyword_putc",
+        "Identifier", "Integer", "String",
+        "End_of_input", "Error"
+    };
+
+    return s[static_cast<int>(name)];
+}
+
+
+// The keyword a word spells, or IDENTIFIER. Its length and first letter narrow it down to at most one keyword, which
+// one compare then confirms, so no string is built and no table searched.
+inline TokenName classify_word (const char* p, size_t n)
+{
+    auto is = [&](const char* keyword, TokenName name)
+    {
+        return memcmp(p + 1, keyword + 1, n - 1) == 0 ? name : TokenName::IDENTIFIER;
+    };
+
+    switch (n)
+    {
+        case 2  :    if (p[0] == 'i')    return is("if",    TokenName::KEYWORD_IF);
+                     break;
+
+        case 4  :    if (p[0] == 'e')    return is("else",  TokenName::KEYWORD_ELSE);
+                     if (p[0] == 'p')    return is("putc",  TokenName::KEYWORD_PUTC);
+                     break;
+
+        case 5  :    if (p[0] == 'p')    return is("print", TokenName::KEYWORD_PRINT);
+                     if (p[0] == 'w')    return is("while", TokenName::KEYWORD_WHILE);
+                     break;
+    }
+
+    return TokenName::IDENTIFIER;
+}
+
+
+// What each token prints in the Token name column. Tokens that carry a value are padded out to the Value column.
+const auto token_labels = []
+{
+    const int count = static_cast<int>(TokenName::ERROR) + 1;
+
+    array<string, count> labels;
+
+    for (int i = 0; i < count; ++i)    labels[i] = to_cstring(static_cast<TokenName>(i));
+
+    for (auto name : {TokenName::IDENTIFIER, TokenName::INTEGER, TokenName::STRING, TokenName::ERROR})
+        labels[static_cast<int>(name)].resize(18, ' ');
+
+    labels[static_cast<int>(TokenName::STRING)] += '"';
+
+    return labels;
+}();
+
+
+// Location columns are right-aligned to a width of two
+inline char* write_location (char* p, int n)
+{
+    if (n >= 0 && n < 10)    *p++ = ' ';
+
+    return to_chars(p, p + 11, n).ptr;
+}
+
+
+// Start a text record: its location and label, with room left behind them for an integer value and the newline
+template <class Out>
+char* write_record_start (Out& out, TokenName name, int line, int column)
+{
+    const string& label = token_labels[static_cast<int>(name)];
+
+    char* p = out.reserve(2 * 11 + 6 + label.size() + 11 + 1);
+
+    p = write_location(p, line);      p = copy_n("   ", 3, p);
+    p = write_location(p, column);    p = copy_n("   ", 3, p);
+
+    return copy(label.begin(), label.end(), p);
+}
+
+
+// Append the text record for t to out, which provides reserve(), commit() and append() like OutputBuffer
+template <class Out>
+void write_token (Out& out, const Token& t)
+{
+    char* p = write_record_start(out, t.name, t.line, t.column);
+
+    switch (t.name)
+    {
+        case (TokenName::INTEGER)    :    p = to_chars(p, p + 11, get<int>(t.value)).ptr;
+                                          break;
+
+        case (TokenName::IDENTIFIER) :
+        case (TokenName::ERROR)      :    out.commit(p);
+                                          out.append(get<string>(t.value));
+                                          p = out.reserve(1);
+                                          break;
+
+        case (TokenName::STRING)     :    out.commit(p);
+                                          write_escaped(out, get<string>(t.value));
+                                          p = out.reserve(2);
+                                          *p++ = '"';
+                                          break;
+
+        default                      :    break;
+    }
+
+    *p++ = '\n';
+    out.commit(p);
+}
+
+
+string to_string (Token t)
+{
+    OutputBuffer out;
+    write_token(out, t);
+
+    return {out.data(), out.size()};
+}
+
+
+// The message of an Error whose code starts at the given line and column
+string error_message (LexError error, const char* code, uint32_t length, int line, int column)
+{
+    // Where the lexer stopped, just past the code
+    int end_line   = line   + static_cast<int>(count_newlines(code, length));
+    int end_column = column + static_cast<int>(length);
+
+    // The excerpt is the code on the line the lexer stopped on
+    string_view excerpt {code, length};
+
+    if (end_line != line)
+    {
+        excerpt    = excerpt.substr(excerpt.rfind('\n') + 1);
+        end_column = static_cast<int>(excerpt.size()) + 1;
+    }
+
+    ostringstream msg;
+
+    switch (error)
+    {
+        case LexError::UNRECOGNIZED_CHARACTER :    msg << "Unrecognized character '" << code[length] << "'";   break;
+        case LexError::EOF_IN_COMMENT         :    msg << "End-of-file in comment."
+                                                          " Closing comment characters not found.";
+                                                   break;
+        case LexError::EMPTY_CHARACTER        :    msg << "Empty character constant";                           break;
+        case LexError::UNKNOWN_ESCAPE         :    msg << "Unknown escape sequence \\" << code[length];          break;
+        case LexError::MULTI_CHARACTER        :    msg << "Multi-character constant";                           break;
+        case LexError::EOL_IN_STRING          :    msg << "End-of-line while scanning string literal."
+                                                          " Closing string character not found before end-of-line.";
+                                                   break;
+        case LexError::EOF_IN_STRING          :    msg << "End-of-file while scanning string literal."
+                                                          " Closing string character not found.";
+                                                   break;
+        case LexError::INVALID_NUMBER         :    msg << "Invalid number. Starts like a number, but ends in"
+                                                          " non-numeric characters.";
+                                                   break;
+        case LexError::NUMBER_TOO_LARGE       :    msg << "Number exceeds maximum value";                       break;
+    }
+
+    msg << '\n' << string(28, ' ') << "(" << end_line << ", " << end_column << "): " << excerpt;
+
+    return msg.str();
+}
+
+
+// Expand t, whose text starts at the given line and column, into a Token
+Token to_token (const CompactToken& t, const char* text, int line, int column)
+{
+    switch (t.name)
+    {
+        case TokenName::IDENTIFIER :    return {t.name, string {text, t.length},             line, column};
+        case TokenName::STRING     :    return {t.name, unescape({text + 1, t.length - 2}),  line, column};
+        case TokenName::INTEGER    :    return {t.name, t.value,                             line, column};
+        case TokenName::ERROR      :    return {t.name, error_message(static_cast<LexError>(t.value), text, t.length,
+                                                                      line, column),         line, column};
+        default                    :    return {t.name, 0,                                   line, column};
+    }
+}
+
+
+// Expand t into a Token, finding its line and column by counting through the source it was lexed from
+Token to_token (const CompactToken& t, string_view source)
+{
+    int line   = 1 + static_cast<int>(count_newlines(source.data(), t.offset));
+    int column = static_cast<int>(t.offset - source.substr(0, t.offset).rfind('\n'));
+
+    return to_token(t, source.data() + t.offset, line, column);
+}
+
+
+// A token as BasicLexer::run hands it to a sink: its kind, its text in the source, its CompactToken value and where it
+// starts. The text is only valid until the lexer moves on. Converts to a Token for sinks that want one.
+struct TokenSpan
+{
+    TokenName   name;
+    string_view text;
+    int32_t     value;
+    int         line;
+    int         column;
+
+    operator Token () const
+    {
+        CompactToken t {name, 0, static_cast<uint32_t>(text.size()), value};
+        return to_token(t, text.data(), line, column);
+    }
+};
+
+
+// The same record write_token gives for the Token t converts to, written from the source text. Only an Error's message
+// has to be built; a string's escapes are already written the way they appear in the source.
+template <class Out>
+void write_token (Out& out, const TokenSpan& t)
+{
+    if (t.name == TokenName::ERROR)    return write_token(out, static_cast<Token>(t));
+
+    char* p = write_record_start(out, t.name, t.line, t.column);
+
+    switch (t.name)
+    {
+        case (TokenName::INTEGER)    :    p = to_chars(p, p + 11, t.value).ptr;
+                                          break;
+
+        case (TokenName::IDENTIFIER) :    out.commit(p);
+                                          out.append(t.text);
+                                          p = out.reserve(1);
+                                          break;
+
+        case (TokenName::STRING)     :    out.commit(p);
+                                          out.append(t.text.substr(1));    // the label has the opening quote
+                                          p = out.reserve(1);
+                                          break;
+
+        default                      :    break;
+    }
+
+    *p++ = '\n';
+    out.commit(p);
+}
+
+
+// A sink writing each token's text record to out. This is what the lex command prints.
+template <class Out>
+struct TextSink
+{
+    Out& out;
+
+    void operator() (const TokenSpan& t)    { write_token(out, t); }
+};
+
+
+// Tokens stored column by column rather than token by token, so a pass that only needs some of their fields (kinds for
+// a parser, positions for a statistics pass) streams through just those arrays. Each column is indexed by token.
+struct TokenColumns
+{
+    vector<uint8_t>  kind;      // TokenName
+    vector<uint32_t> offset;    // of the token's first character in the source
+    vector<int32_t>  line;
+    vector<int32_t>  column;
+    vector<int32_t>  value;     // an Integer's value, an Identifier's symbol, the index into strings of other values'
+                                // text, otherwise 0
+    vector<string>   strings;
+    SymbolTable      symbols;
+
+    size_t size () const    { return kind.size(); }
+
+    void clear ()
+    {
+        kind.clear(); offset.clear(); line.clear(); column.clear(); value.clear(); strings.clear(); symbols.clear();
+    }
+
+    // Add t, whose text starts at the given line and column. An Identifier's value must already be its symbol in
+    // symbols, as it is from a Lexer interning into them; only strings and error messages are copied out.
+    void push_back (const CompactToken& t, const char* text, int line, int column)
+    {
+        kind.push_back(static_cast<uint8_t>(t.name));
+        offset.push_back(t.offset);
+        this->line.push_back(line);
+        this->column.push_back(column);
+
+        switch (t.name)
+        {
+            case TokenName::STRING :    value.push_back(static_cast<int32_t>(strings.size()));
+                                        strings.push_back(unescape({text + 1, t.length - 2}));
+                                        break;
+
+            case TokenName::ERROR  :    value.push_back(static_cast<int32_t>(strings.size()));
+                                        strings.push_back(error_message(static_cast<LexError>(t.value), text, t.length,
+                                                                        line, column));
+                                        break;
+
+            default                :    value.push_back(t.value);
+                                        break;
+        }
+    }
+
+    Token operator[] (size_t i) const
+    {
+        auto name = static_cast<TokenName>(kind[i]);
+
+        switch (name)
+        {
+            case TokenName::IDENTIFIER :    return {name, string {symbols.name(value[i])}, line[i], column[i]};
+            case TokenName::STRING     :
+            case TokenName::ERROR      :    return {name, strings[value[i]],               line[i], column[i]};
+            default                    :    return {name, value[i],                        line[i], column[i]};
+        }
+    }
+}; // struct TokenColumns
+
+
+// How many tokens there are of each kind, reading only the kind column
+inline array<size_t, static_cast<int>(TokenName::ERROR) + 1> count_kinds (const TokenColumns& tokens)
+{
+    array<size_t, static_cast<int>(TokenName::ERROR) + 1> counts {};
+
+    for (uint8_t k : tokens.kind)    ++counts[k];
+
+    return counts;
+}
+
+
+// =====================================================================================================================
+// Binary token stream
+// =====================================================================================================================
+// A compact binary form of a token stream, laid out so that it can be mapped into memory and read in place:
+//
+//     header     a TokenStreamHeader
+//     tokens     per token, its TokenName as one byte, then as varints its line less the previous token's line, its
+//                column (less the previous token's column if on the same line) and its value: a zigzag-encoded Integer,
+//                or the offset and length in the string pool of an Identifier, String or Error's text
+//     index      a TokenStreamIndex entry for every index_interval'th token, to start reading part way through
+//     strings    the text of the values, each distinct text stored once
+//
+// Integers in the header and index are stored in the machine's byte order, which must be little-endian.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the binary token stream is little-endian");
+
+struct TokenStreamHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t index_interval;
+    uint64_t token_count;
+    uint64_t tokens_offset,  tokens_size;
+    uint64_t index_offset,   index_count;
+    uint64_t strings_offset, strings_size;
+
+    static constexpr char     expected_magic[8] = {'R', 'C', 'L', 'E', 'X', 'T', 'O', 'K'};
+    static constexpr uint32_t current_version   = 1;
+};
+
+
+struct TokenStreamIndex
+{
+    uint64_t offset;    // into the token section
+    uint32_t line;
+    uint32_t column;
+};
+
+
+inline char* write_varint (char* p, uint64_t n)
+{
+    for (; n >= 0x80; n >>= 7)    *p++ = static_cast<char>(n | 0x80);
+    *p++ = static_cast<char>(n);
+
+    return p;
+}
+
+
+inline uint64_t read_varint (const char*& p, const char* end)
+{
+    uint64_t n = 0;
+
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        auto byte = static_cast<unsigned char>(*p++);
+        n |= uint64_t(byte & 0x7f) << shift;
+
+        if (byte < 0x80)    return n;
+    }
+
+    throw runtime_error("truncated token stream");
+}
+
+
+// Collects tokens in the binary form, then writes the whole stream out at once
+class TokenStreamWriter
+{
+public:
+    static constexpr uint32_t index_interval = 1024;
+
+    void add (const Token& t)
+    {
+        if (count % index_interval == 0)
+            index.push_back({tokens.size(), static_cast<uint32_t>(t.line), static_cast<uint32_t>(t.column)});
+
+        char* p = tokens.reserve(1 + 3 * 10);
+
+        *p++ = static_cast<char>(t.name);
+        p = write_varint(p, t.line - line);
+        p = write_varint(p, (t.line == line) ? t.column - column : t.column);
+
+        if (t.name == TokenName::INTEGER)
+        {
+            int n = get<int>(t.value);
+            p = write_varint(p, (uint64_t(n) << 1) ^ uint64_t(n >> 31));
+        }
+        else if (auto text = get_if<string>(&t.value))
+        {
+            auto [entry, added] = pool.try_emplace(*text, strings.size());
+            if (added)    strings.append(*text);
+
+            p = write_varint(p, entry->second);
+            p = write_varint(p, text->size());
+        }
+
+        tokens.commit(p);
+
+        line   = t.line;
+        column = t.column;
+        ++count;
+    }
+
+    template <class Out>
+    void write (Out& out) const
+    {
+        TokenStreamHeader header {};
+        copy_n(TokenStreamHeader::expected_magic, 8, header.magic);
+
+        header.version        = TokenStreamHeader::current_version;
+        header.index_interval = index_interval;
+        header.token_count    = count;
+        header.tokens_offset  = sizeof header;
+        header.tokens_size    = tokens.size();
+        header.index_offset   = header.tokens_offset + header.tokens_size;
+        header.index_count    = index.size();
+        header.strings_offset = header.index_offset + index.size() * sizeof(TokenStreamIndex);
+        header.strings_size   = strings.size();
+
+        out.append(reinterpret_cast<const char*>(&header), sizeof header);
+        out.append(tokens.data(), tokens.size());
+        out.append(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(TokenStreamIndex));
+        out.append(strings.data(), strings.size());
+    }
+
+private:
+    OutputBuffer                     tokens;
+    OutputBuffer                     strings;
+    vector<TokenStreamIndex>         index;
+    unordered_map<string, uint64_t>  pool;
+    uint64_t                         count  = 0;
+    int                              line   = 0;
+    int                              column = 0;
+}; // class TokenStreamWriter
+
+
+// A token read back from a binary token stream. Its text points into the stream.
+struct TokenRecord
+{
+    TokenName   name;
+    int         line;
+    int         column;
+    int         integer;
+    string_view text;
+};
+
+
+inline Token to_token (const TokenRecord& r)
+{
+    bool has_text = (r.name == TokenName::IDENTIFIER || r.name == TokenName::STRING || r.name == TokenName::ERROR);
+
+    return {r.name, has_text ? TokenVal {string {r.text}} : TokenVal {r.integer}, r.line, r.column};
+}
+
+
+// Reads tokens in place from a binary token stream in memory, such as a MappedFile
+class TokenStreamReader
+{
+public:
+    explicit TokenStreamReader (string_view bytes) : bytes {bytes}
+    {
+        if (bytes.size() < sizeof header)    throw runtime_error("not a token stream");
+
+        memcpy(&header, bytes.data(), sizeof header);
+
+        if (!equal(header.magic, header.magic + 8, TokenStreamHeader::expected_magic))
+            throw runtime_error("not a token stream");
+
+        if (header.version != TokenStreamHeader::current_version)
+            throw runtime_error("unsupported token stream version " + std::to_string(header.version));
+
+        auto fits = [&](uint64_t offset, uint64_t size)
+        {
+            return offset <= bytes.size() && size <= bytes.size() - offset;
+        };
+
+        if (!fits(header.tokens_offset,  header.tokens_size)                                  ||
+            !fits(header.index_offset,   header.index_count * sizeof(TokenStreamIndex))       ||
+            !fits(header.strings_offset, header.strings_size)                                 ||
+            header.index_interval == 0                                                        ||
+            header.index_count != (header.token_count + header.index_interval - 1) / header.index_interval)
+            throw runtime_error("corrupt token stream");
+    }
+
+    class iterator
+    {
+    public:
+        using iterator_category = input_iterator_tag;
+        using value_type        = TokenRecord;
+        using difference_type   = ptrdiff_t;
+        using pointer           = const TokenRecord*;
+        using reference         = const TokenRecord&;
+
+        iterator (const TokenStreamReader& stream, uint64_t i, const char* p, int line, int column)
+            : stream {&stream}, i {i}, p {p}
+        {
+            record.line   = line;
+            record.column = column;
+
+            if (i < stream.size())    decode(true);
+        }
+
+        reference operator*  () const    { return record; }
+        pointer   operator-> () const    { return &record; }
+
+        iterator& operator++ ()
+        {
+            if (++i < stream->size())    decode(false);
+            return *this;
+        }
+
+        bool operator== (const iterator& other) const    { return i == other.i; }
+        bool operator!= (const iterator& other) const    { return i != other.i; }
+
+    private:
+        const TokenStreamReader* stream;
+        uint64_t                 i;
+        const char*              p;
+        TokenRecord              record {};
+
+        // Decode the token at p. A token at an index entry is decoded against the entry's position, which is that
+        // token's own, so its deltas come out as zero.
+        void decode (bool at_entry)
+        {
+            const char* end = stream->tokens_end();
+
+            if (p == end)    throw runtime_error("truncated token stream");
+
+            record.name = static_cast<TokenName>(static_cast<unsigned char>(*p++));
+            if (record.name > TokenName::ERROR)    throw runtime_error("corrupt token stream");
+
+            uint64_t line_delta = read_varint(p, end);
+            uint64_t column     = read_varint(p, end);
+
+            if (at_entry)
+            {
+                line_delta = 0;
+                column     = 0;
+            }
+
+            record.line  += line_delta;
+            record.column = (line_delta == 0) ? record.column + column : column;
+
+            record.integer = 0;
+            record.text    = {};
+
+            if (record.name == TokenName::INTEGER)
+            {
+                uint64_t n = read_varint(p, end);
+                record.integer = static_cast<int>((n >> 1) ^ -(n & 1));
+            }
+            else if (record.name == TokenName::IDENTIFIER || record.name == TokenName::STRING ||
+                     record.name == TokenName::ERROR)
+            {
+                uint64_t offset = read_varint(p, end);
+                uint64_t length = read_varint(p, end);
+
+                if (offset > stream->header.strings_size || length > stream->header.strings_size - offset)
+                    throw runtime_error("corrupt token stream");
+
+                record.text = stream->bytes.substr(stream->header.strings_offset + offset, length);
+            }
+        }
+    }; // class iterator
+
+    uint64_t size () const    { return header.token_count; }
+
+    iterator begin () const    { return at(0); }
+    iterator end   () const    { return {*this, size(), nullptr, 0, 0}; }
+
+    // Start reading at token i, skipping forward from the nearest index entry before it
+    iterator at (uint64_t i) const
+    {
+        if (i >= size())    return end();
+
+        TokenStreamIndex entry;
+        memcpy(&entry, bytes.data() + header.index_offset + (i / header.index_interval) * sizeof entry, sizeof entry);
+
+        if (entry.offset >= header.tokens_size)    throw runtime_error("corrupt token stream");
+
+        iterator it {*this, i - i % header.index_interval, tokens_begin() + entry.offset,
+                     static_cast<int>(entry.line), static_cast<int>(entry.column)};
+
+        for (uint64_t skip = i % header.index_interval; skip > 0; --skip)    ++it;
+
+        return it;
+    }
+
+private:
+    string_view       bytes;
+    TokenStreamHeader header;
+
+    const char* tokens_begin () const    { return bytes.data() + header.tokens_offset; }
+    const char* tokens_end   () const    { return tokens_begin() + header.tokens_size; }
+}; // class TokenStreamReader
+
+
+// =====================================================================================================================
+// Lexer
+// =====================================================================================================================
+// The transitions of a DFA over source bytes that recognises the operators and punctuation, for the table-driven engine
+// the Lexer uses when built with LEX_DFA. Every other kind of token is handed to the Lexer's scanning function for it.
+struct OperatorDFA
+{
+    enum : uint8_t
+    {
+        START, LESS, GREATER, ASSIGN, NOT, AND, OR, STATES,    // moving to a state consumes the byte
+
+        TAKE  = 0x40,    // TAKE + a TokenName accepts that token, the byte included
+        LEAVE = 0x80,    // LEAVE + a TokenName accepts that token, leaving the byte for the next
+
+        IDENTIFIER = 0xF0, NUMBER, CHARACTER, STRING, END, UNRECOGNIZED
+    };
+
+    array<array<uint8_t, 256>, STATES> next {};
+
+    constexpr OperatorDFA ()
+    {
+        for (int state = START; state < STATES; ++state)
+            for (int c = 0; c < 256; ++c)    next[state][c] = UNRECOGNIZED;
+
+        auto& start = next[START];
+
+        for (int c = 0; c < 256; ++c)
+        {
+            if (char_class[c] & CharClass::ID_START)    start[c] = IDENTIFIER;
+            if (char_class[c] & CharClass::DIGIT)       start[c] = NUMBER;
+        }
+
+        start['\''] = CHARACTER;
+        start['"']  = STRING;
+        start[0]    = END;
+
+        const pair<char, TokenName> single[] =
+        {
+            {'*', TokenName::OP_MULTIPLY}, {'/', TokenName::OP_DIVIDE},     {'%', TokenName::OP_MOD},
+            {'+', TokenName::OP_ADD},      {'-', TokenName::OP_SUBTRACT},   {';', TokenName::SEMICOLON},
+            {'(', TokenName::LEFTPAREN},   {')', TokenName::RIGHTPAREN},    {',', TokenName::COMMA},
+            {'{', TokenName::LEFTBRACE},   {'}', TokenName::RIGHTBRACE}
+        };
+
+        for (auto [c, name] : single)    start[c] = take(name);
+
+        // A first character that may begin a two-character operator, with what it makes alone and with a second
+        const tuple<char, uint8_t, char, TokenName, uint8_t> pairs[] =
+        {
+            {'<', LESS,    '=', TokenName::OP_LESSEQUAL,    leave(TokenName::OP_LESS)},
+            {'>', GREATER, '=', TokenName::OP_GREATEREQUAL, leave(TokenName::OP_GREATER)},
+            {'=', ASSIGN,  '=', TokenName::OP_EQUAL,        leave(TokenName::OP_ASSIGN)},
+            {'!', NOT,     '=', TokenName::OP_NOTEQUAL,     leave(TokenName::OP_NOT)},
+            {'&', AND,     '&', TokenName::OP_AND,          UNRECOGNIZED},
+            {'|', OR,      '|', TokenName::OP_OR,           UNRECOGNIZED}
+        };
+
+        for (auto [first, state, second, name, alone] : pairs)
+        {
+            start[first] = state;
+
+            for (int c = 0; c < 256; ++c)    next[state][c] = alone;
+
+            next[state][second] = take(name);
+        }
+    }
+
+    static constexpr uint8_t take  (TokenName name)    { return TAKE  + static_cast<uint8_t>(name); }
+    static constexpr uint8_t leave (TokenName name)    { return LEAVE + static_cast<uint8_t>(name); }
+
+    // Whether the start state takes in an operator exactly where char_class has one, and leaves quotes to the literals
+    constexpr bool agrees_with_char_class () const
+    {
+        for (int c = 0; c < 256; ++c)
+        {
+            uint8_t step     = next[START][c];
+            bool    is_operator = step < STATES || (step >= TAKE && step < LEAVE);
+            bool    is_quote    = step == CHARACTER || step == STRING;
+
+            if (is_operator != ((char_class[c] & CharClass::OPERATOR) != 0))    return false;
+            if (is_quote    != ((char_class[c] & CharClass::QUOTE)    != 0))    return false;
+        }
+
+        return true;
+    }
+}; // struct OperatorDFA
+
+inline constexpr OperatorDFA operator_dfa {};
+
+static_assert(operator_dfa.agrees_with_char_class());
+
+
+// Lexes a '\0'-terminated source a token at a time. With Lines false the lexer keeps no line and column, and gives
+// only CompactTokens.
+template <bool Lines = true>
+class BasicLexer
+{
+public:
+    BasicLexer (const char* source)                            : s {source}, pre_state {s}, base {source} {}
+    BasicLexer (BasicScanner<Lines> state)                     : s {state},  pre_state {s}, base {state.pos} {}
+    BasicLexer (BasicScanner<Lines> state, const char* base)   : s {state},  pre_state {s}, base {base} {}
+
+    const BasicScanner<Lines>& state () const    { return s; }
+
+    // Intern identifiers into symbols, giving each CompactToken for one its symbol ID as its value
+    void intern_into (SymbolTable& symbols)    { this->symbols = &symbols; }
+
+    bool has_more ()    { return s.peek() != '\0'; }
+
+    // Lex up to n more tokens onto the end of columns, stopping early at the end of input. Offsets are from the start
+    // of the source, or from the base given with a starting state. Returns how many tokens were added.
+    size_t lex_into (TokenColumns& columns, size_t n)
+    {
+        static_assert(Lines, "TokenColumns keep each token's line and column");
+
+        SymbolTable* interning = symbols;
+        symbols = &columns.symbols;
+
+        size_t added = 0;
+
+        for (; added < n && has_more(); ++added)
+        {
+            CompactToken t = next_compact();
+            columns.push_back(t, pre_state.pos, pre_state.line, pre_state.column);
+        }
+
+        symbols = interning;
+        return added;
+    }
+
+    Token next_token ()
+    {
+        static_assert(Lines, "an OffsetLexer's tokens get their positions from a LineIndex");
+
+        CompactToken t = next_compact();
+        return to_token(t, pre_state.pos, pre_state.line, pre_state.column);
+    }
+
+    // The next token as run() hands it to a sink
+    TokenSpan next_span ()
+    {
+        static_assert(Lines, "an OffsetLexer's tokens get their positions from a LineIndex");
+
+        CompactToken t = next_compact();
+        return {t.name, {pre_state.pos, t.length}, t.value, pre_state.line, pre_state.column};
+    }
+
+    // Lex the rest of the source, handing sink each token as a const TokenSpan&. The sink is a template parameter, so
+    // its call is inlined into the loop rather than made through a function pointer.
+    template <class Sink>
+    void run (Sink&& sink)
+    {
+        while (has_more())    sink(next_span());
+    }
+
+    // The next token as a span of the source, without allocating. Its offset is from the base.
+    CompactToken next_compact ()
+    {
+        s.skip_whitespace();
+
+        // Comments are skipped in a loop rather than by lexing on from their end, so a run of them uses no more stack
+        while (s.peek() == '/' && s.pos[1] == '*')
+        {
+            pre_state = s;
+
+            auto [end, closed] = comment_end(s.pos + 2);
+            s.advance_to(end);
+
+            if (!closed)    return error(LexError::EOF_IN_COMMENT);
+
+            s.skip_whitespace();
+        }
+
+        pre_state = s;
+
+#if defined(LEX_DFA)
+        return next_by_table();
+#else
+        switch (s.peek())
+        {
+            case '*'  :    return simply(TokenName::OP_MULTIPLY);
+            case '%'  :    return simply(TokenName::OP_MOD);
+            case '+'  :    return simply(TokenName::OP_ADD);
+            case '-'  :    return simply(TokenName::OP_SUBTRACT);
+            case '{'  :    return simply(TokenName::LEFTBRACE);
+            case '}'  :    return simply(TokenName::RIGHTBRACE);
+            case '('  :    return simply(TokenName::LEFTPAREN);
+            case ')'  :    return simply(TokenName::RIGHTPAREN);
+            case ';'  :    return simply(TokenName::SEMICOLON);
+            case ','  :    return simply(TokenName::COMMA);
+            case '&'  :    return expect('&', TokenName::OP_AND);
+            case '|'  :    return expect('|', TokenName::OP_OR);
+            case '<'  :    return follow('=', TokenName::OP_LESSEQUAL,    TokenName::OP_LESS);
+            case '>'  :    return follow('=', TokenName::OP_GREATEREQUAL, TokenName::OP_GREATER);
+            case '='  :    return follow('=', TokenName::OP_EQUAL,        TokenName::OP_ASSIGN);
+            case '!'  :    return follow('=', TokenName::OP_NOTEQUAL,     TokenName::OP_NOT);
+            case '/'  :    return simply(TokenName::OP_DIVIDE);
+            case '\'' :    return char_lit();
+            case '"'  :    return string_lit();
+
+            default   :    if (is_id_start(s.peek()))    return identifier();
+                           if (is_digit(s.peek()))       return integer_lit();
+                           return error(LexError::UNRECOGNIZED_CHARACTER);
+
+            case '\0' :    return make_token(TokenName::END_OF_INPUT);
+        }
+#endif
+    }
+
+
+private:
+    BasicScanner<Lines> s;
+    BasicScanner<Lines> pre_state;
+    const char*         base;
+    SymbolTable*        symbols = nullptr;
+
+
+    // The token at s by table lookups in operator_dfa, which take at most two steps
+    CompactToken next_by_table ()
+    {
+        const char* p    = s.pos;
+        uint8_t     step = operator_dfa.next[OperatorDFA::START][static_cast<unsigned char>(*p)];
+
+        if (step < OperatorDFA::STATES)    step = operator_dfa.next[step][static_cast<unsigned char>(*++p)];
+
+        // An operator, taking the byte at p or leaving it for the next token
+        if (step < OperatorDFA::IDENTIFIER)
+        {
+            bool taken = step < OperatorDFA::LEAVE;
+
+            s.skip_to(taken ? p + 1 : p);
+            return make_token(TokenName(step - (taken ? OperatorDFA::TAKE : OperatorDFA::LEAVE)));
+        }
+
+        switch (step)
+        {
+            case OperatorDFA::IDENTIFIER :    return identifier();
+            case OperatorDFA::NUMBER     :    return integer_lit();
+            case OperatorDFA::CHARACTER  :    return char_lit();
+            case OperatorDFA::STRING     :    return string_lit();
+            case OperatorDFA::END        :    return make_token(TokenName::END_OF_INPUT);
+            default                      :    s.skip_to(p);
+                                              return error(LexError::UNRECOGNIZED_CHARACTER);
+        }
+    }
+
+
+    CompactToken error (LexError e)
+    {
+        CompactToken token = make_token(TokenName::ERROR, static_cast<int32_t>(e));
+
+        if (s.peek() != '\0')    s.advance();
+
+        return token;
+    }
+
+
+    inline CompactToken make_token (TokenName name, int32_t value = 0)
+    {
+        return {name, static_cast<uint32_t>(pre_state.pos - base), static_cast<uint32_t>(s.pos - pre_state.pos), value};
+    }
+
+
+    CompactToken simply (TokenName name)
+    {
+        s.advance();
+        return make_token(name);
+    }
+
+
+    CompactToken expect (char expected, TokenName name)
+    {
+        return s.next() == expected ? simply(name) : error(LexError::UNRECOGNIZED_CHARACTER);
+    }
+
+
+    CompactToken follow (char expected, TokenName ifyes, TokenName ifno)
+    {
+        return s.next() == expected ? simply(ifyes) : make_token(ifno);
+    }
+
+
+    CompactToken char_lit ()
+    {
+        int n = s.next();
+
+        if (n == '\'')    return error(LexError::EMPTY_CHARACTER);
+        if (n == '\0')    return error(LexError::MULTI_CHARACTER);     // the input ends at the quote; read no further
+
+        if (n == '\\')    switch (s.next())
+                          {
+                              case 'n'  :    n = '\n'; break;
+                              case '\\' :    n = '\\'; break;
+                              default   :    return error(LexError::UNKNOWN_ESCAPE);
+                          }
+
+        if (s.next() != '\'')    return error(LexError::MULTI_CHARACTER);
+
+        s.advance();
+        return make_token(TokenName::INTEGER, n);
+    }
+
+
+    // Clean runs of text are skipped a vector at a time, and only the characters that end them looked at
+    CompactToken string_lit ()
+    {
+        for (const char* p = s.pos + 1; ; p += 2)
+        {
+            p = skip_string_text(p);
+
+            if (*p == '\\' && (p[1] == 'n' || p[1] == '\\'))    continue;
+
+            switch (*p)
+            {
+                case '"'  :    s.skip_to(p + 1);    return make_token(TokenName::STRING);
+                case '\\' :    s.skip_to(p + 1);    return error(LexError::UNKNOWN_ESCAPE);
+                case '\n' :    s.skip_to(p);        return error(LexError::EOL_IN_STRING);
+                default   :    s.skip_to(p);        return error(LexError::EOF_IN_STRING);
+            }
+        }
+    }
+
+
+    static inline bool is_id_start (char c)    { return has_class(c, CharClass::ID_START); }
+    static inline bool is_digit    (char c)    { return has_class(c, CharClass::DIGIT);    }
+
+
+    CompactToken identifier ()
+    {
+        s.skip_to(skip_word(s.pos + 1));
+
+        string_view text {pre_state.pos, static_cast<size_t>(s.pos - pre_state.pos)};
+
+        TokenName name = classify_word(text.data(), text.size());
+        if (name != TokenName::IDENTIFIER)    return make_token(name);
+
+        return make_token(TokenName::IDENTIFIER, symbols ? static_cast<int32_t>(symbols->intern(text)) : 0);
+    }
+
+
+    CompactToken integer_lit ()
+    {
+        while (is_digit(s.next()));
+
+        if (is_id_start(s.peek()))    return error(LexError::INVALID_NUMBER);
+
+        int n;
+
+        auto r = from_chars(pre_state.pos, s.pos, n);
+        if (r.ec == errc::result_out_of_range)    return error(LexError::NUMBER_TOO_LARGE);
+
+        return make_token(TokenName::INTEGER, n);
+    }
+}; // class BasicLexer
+
+using Lexer       = BasicLexer<true>;
+using OffsetLexer = BasicLexer<false>;
+
+
+// The tokens of a lexer as a lazy input range, for range-for loops and <ranges> adaptors. Each token is lexed when the
+// iterator steps onto it and is read in place, so nothing is copied or kept beyond the current token. Gives Tokens, or
+// with Lines false CompactTokens.
+template <bool Lines = true>
+class BasicTokenRange : public ranges::view_interface<BasicTokenRange<Lines>>
+{
+public:
+    using value_type = conditional_t<Lines, Token, CompactToken>;
+
+    class iterator
+    {
+    public:
+        using iterator_concept = input_iterator_tag;
+        using value_type       = BasicTokenRange::value_type;
+        using difference_type  = ptrdiff_t;
+
+        iterator () = default;
+        explicit iterator (BasicTokenRange* range) : range {range} {}
+
+        const value_type& operator*  () const    { return range->current; }
+        const value_type* operator-> () const    { return &range->current; }
+
+        iterator& operator++ ()       { range->advance(); return *this; }
+        void      operator++ (int)    { range->advance(); }
+
+        friend bool operator== (const iterator& i, default_sentinel_t)    { return i.at_end(); }
+
+
+    private:
+        BasicTokenRange* range = nullptr;
+
+        bool at_end () const    { return range->done; }
+    };
+
+    BasicTokenRange (const char* source)           : lexer {source} {}
+    BasicTokenRange (BasicLexer<Lines> lexer)      : lexer {move(lexer)} {}
+
+    iterator begin ()
+    {
+        advance();
+        return iterator {this};
+    }
+
+    default_sentinel_t end () const    { return {}; }
+
+
+private:
+    BasicLexer<Lines> lexer;
+    value_type        current {};
+    bool              done = false;
+
+
+    void advance ()
+    {
+        if (!lexer.has_more())         done = true;
+        else if constexpr (Lines)      current = lexer.next_token();
+        else                           current = lexer.next_compact();
+    }
+}; // class BasicTokenRange
+
+using TokenRange = BasicTokenRange<true>;
+using SpanRange  = BasicTokenRange<false>;
+
+static_assert(ranges::input_range<TokenRange> && ranges::view<TokenRange>);
+
+
+// How much a TokenGenerator lexes before it pauses of its own accord, by whichever limit comes first. Time is checked
+// every 64 tokens, so a pause may come that many tokens late. The time budget can overrun: bench/generator has measured
+// pauses more than twice a 100 us budget apart.
+struct LexBudget
+{
+    size_t                bytes  = SIZE_MAX;
+    size_t                tokens = SIZE_MAX;
+    chrono::nanoseconds   time   = chrono::nanoseconds::max();
+};
+
+// What a TokenGenerator yields to pause rather than give a token
+struct LexPause {};
+
+// A coroutine that lexes a source, yielding each token in turn and pausing whenever its LexBudget is spent, so that a
+// caller in an event loop can lex a large source a slice at a time between other work
+class TokenGenerator
+{
+public:
+    struct promise_type
+    {
+        const Token*  token = nullptr;    // while suspended at a token, which lives in the coroutine until it resumes
+        exception_ptr error;
+
+        TokenGenerator get_return_object ()
+        {
+            return TokenGenerator {coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        suspend_always initial_suspend () noexcept    { return {}; }
+        suspend_always final_suspend   () noexcept    { return {}; }
+
+        suspend_always yield_value (const Token& t) noexcept    { token = &t;      return {}; }
+        suspend_always yield_value (LexPause)       noexcept    { token = nullptr; return {}; }
+
+        void return_void ()            {}
+        void unhandled_exception ()    { error = current_exception(); }
+    };
+
+    TokenGenerator (TokenGenerator&& other) noexcept : coroutine {exchange(other.coroutine, {})} {}
+    TokenGenerator& operator= (TokenGenerator&& other) noexcept
+    {
+        swap(coroutine, other.coroutine);
+        return *this;
+    }
+
+    ~TokenGenerator ()    { if (coroutine)    coroutine.destroy(); }
+
+    // Lex on to the next token or pause. False once the source is finished, and on every call after that; an exception
+    // from the lexer comes out here.
+    bool resume ()
+    {
+        if (coroutine.done())    return false;
+
+        coroutine.resume();
+
+        if (coroutine.promise().error)    rethrow_exception(coroutine.promise().error);
+
+        return !coroutine.done();
+    }
+
+    bool         paused () const    { return coroutine.promise().token == nullptr; }
+    const Token& token  () const    { return *coroutine.promise().token; }
+
+
+private:
+    coroutine_handle<promise_type> coroutine;
+
+    explicit TokenGenerator (coroutine_handle<promise_type> coroutine) : coroutine {coroutine} {}
+}; // class TokenGenerator
+
+
+// The tokens of the '\0'-terminated source as a TokenGenerator that pauses after each budget's worth of lexing
+TokenGenerator generate_tokens (const char* source, LexBudget budget)
+{
+    Lexer       lexer  {source};
+    const char* mark   = source;
+    size_t      tokens = 0;
+    auto        start  = chrono::steady_clock::now();
+
+    while (lexer.has_more())
+    {
+        co_yield lexer.next_token();
+
+        bool spent = ++tokens >= budget.tokens || static_cast<size_t>(lexer.state().pos - mark) >= budget.bytes
+                  || (tokens % 64 == 0 && chrono::steady_clock::now() - start >= budget.time);
+
+        if (spent)
+        {
+            co_yield LexPause {};
+
+            mark   = lexer.state().pos;
+            tokens = 0;
+            start  = chrono::steady_clock::now();
+        }
+    }
+}
+
+
+// =====================================================================================================================
+// Drivers
+// =====================================================================================================================
+template <class Emit>
+void lex_buffer (string_view input, Emit&& emit)
+{
+    Lexer {input.data()}.run(emit);
+}
+
+
+// The same tokens as lex_buffer, from a lexer that keeps only offsets. Each token's line and column is worked out from
+// a LineIndex as it is handed over. Offsets are 32 bits, so the input must be under 4 GiB.
+template <class Emit>
+void lex_offsets (string_view input, Emit&& emit)
+{
+    LineIndex   lines  {input};
+    LineCursor  cursor {lines};
+    OffsetLexer lexer  {input.data()};
+
+    while (lexer.has_more())
+    {
+        CompactToken t = lexer.next_compact();
+        auto [line, column] = cursor.position(t.offset);
+
+        emit(TokenSpan {t.name, {input.data() + t.offset, t.length}, t.value, line, column});
+    }
+}
+
+
+// A fixed-size window onto a file descriptor. The data read so far is always followed by '\0' padding, which the
+// Scanner takes for the end of input.
+class StreamBuffer
+{
+public:
+    static constexpr size_t padding = 8;    // lookahead past a '\0' stays in bounds
+
+    StreamBuffer (int fd, size_t capacity = 64 * 1024) : fd {fd}, storage (capacity + padding) {}
+
+    const char* begin () const    { return storage.data(); }
+    const char* end   () const    { return storage.data() + size; }
+    bool        eof   () const    { return at_eof; }
+
+    // Discard everything before keep and read more input after the rest, which moves to the front of the window. The
+    // window doubles when the kept bytes would leave less than half of it to read into. Returns the new begin().
+    const char* refill (const char* keep)
+    {
+        size_t kept = end() - keep;
+        memmove(storage.data(), keep, kept);
+
+        if (kept > capacity() / 2)    storage.resize(2 * capacity() + padding);
+
+        ssize_t n;
+        do    n = read(fd, storage.data() + kept, capacity() - kept);
+        while (n < 0 && errno == EINTR);
+
+        if (n < 0)    throw (errno);
+
+        at_eof = (n == 0);
+        size   = kept + n;
+        memset(storage.data() + size, '\0', padding);
+
+        return begin();
+    }
+
+private:
+    int          fd;
+    vector<char> storage;
+    size_t       size   = 0;
+    bool         at_eof = false;
+
+    size_t capacity () const    { return storage.size() - padding; }
+}; // class StreamBuffer
+
+
+// Lex a descriptor window by window, emitting each token as soon as it is known to be complete. A token that runs
+// into the end of the window may continue in the next read, so the Lexer is rewound to just before it and the
+// unconsumed tail is carried over into the refilled window. flush is called before every read that may block.
+template <class Emit, class Flush>
+void lex_stream (int fd, Emit&& emit, Flush&& flush)
+{
+    StreamBuffer buffer {fd};
+    Lexer        lexer  {buffer.refill(buffer.end())};
+
+    while (true)
+    {
+        Scanner mark = lexer.state();
+
+        if (mark.pos == buffer.end() && !buffer.eof())
+        {
+            flush();
+            mark.pos = buffer.refill(mark.pos);
+            lexer    = Lexer {mark};
+            continue;
+        }
+
+        if (!lexer.has_more())    break;
+
+        TokenSpan token = lexer.next_span();
+
+        if (lexer.state().pos < buffer.end() || buffer.eof())
+        {
+            emit(token);
+            continue;
+        }
+
+        // Whitespace running off the window needn't be carried, bar its last byte so has_more() still sees it
+        while (mark.pos + 1 < buffer.end() && has_class(mark.peek(), CharClass::SPACE))
+            mark.advance();
+
+        flush();
+        mark.pos = buffer.refill(mark.pos);
+        lexer    = Lexer {mark};
+    }
+}
+
+
+// =====================================================================================================================
+// Incremental lexing
+// =====================================================================================================================
+// A change to a source: removed bytes taken out at offset, and inserted put in their place
+struct SourceEdit
+{
+    uint32_t    offset;
+    uint32_t    removed;
+    string_view inserted;
+};
+
+// The tokens an edit replaced: from first, removed of the old tokens gave way to inserted new ones
+struct TokenChange
+{
+    size_t first;
+    size_t removed;
+    size_t inserted;
+};
+
+
+// The CompactTokens of a whole source, ready to be kept up to date with relex()
+vector<CompactToken> lex_spans (string_view source, SymbolTable* symbols = nullptr)
+{
+    vector<CompactToken> tokens;
+    OffsetLexer          lexer {source.data()};
+
+    if (symbols)    lexer.intern_into(*symbols);
+
+    while (lexer.has_more())    tokens.push_back(lexer.next_compact());
+
+    return tokens;
+}
+
+
+// Bring tokens, lexed from a source before edit, up to date with source, the '\0'-terminated text after it. Lexing
+// restarts at the last token to start before the edit, which the Lexer reached without looking at the edited text, and
+// stops at the first token past the edit to start where one started before. The text from there on is unchanged, so
+// it lexes to the same tokens as before, and they are kept with their offsets moved by the change in length.
+TokenChange relex (vector<CompactToken>& tokens, string_view source, const SourceEdit& edit,
+                   SymbolTable* symbols = nullptr)
+{
+    auto   before = [](const CompactToken& t, uint32_t offset) { return t.offset < offset; };
+    size_t first  = lower_bound(tokens.begin(), tokens.end(), edit.offset, before) - tokens.begin();
+    uint32_t restart = 0;
+    if (first > 0)    restart = tokens[--first].offset;
+
+    int64_t  shift      = static_cast<int64_t>(edit.inserted.size()) - edit.removed;
+    uint32_t edited_end = edit.offset + static_cast<uint32_t>(edit.inserted.size());
+
+    OffsetLexer lexer {OffsetScanner {source.data() + restart}, source.data()};
+    if (symbols)    lexer.intern_into(*symbols);
+
+    vector<CompactToken> fresh;
+    size_t               kept = tokens.size();    // the first old token that is still good
+
+    for (size_t old = first; lexer.has_more(); )
+    {
+        CompactToken t = lexer.next_compact();
+
+        if (t.offset >= edited_end)
+        {
+            while (old < tokens.size() && tokens[old].offset + shift < t.offset)    ++old;
+
+            if (old < tokens.size() && tokens[old].offset + shift == t.offset)
+            {
+                kept = old;
+                break;
+            }
+        }
+
+        fresh.push_back(t);
+    }
+
+    for (size_t i = kept; i < tokens.size(); ++i)    tokens[i].offset = static_cast<uint32_t>(tokens[i].offset + shift);
+
+    size_t removed = kept - first;
+
+    if (fresh.size() > removed)    tokens.insert(tokens.begin() + kept, fresh.size() - removed, CompactToken {});
+    else                           tokens.erase(tokens.begin() + first + fresh.size(), tokens.begin() + kept);
+
+    copy(fresh.begin(), fresh.end(), tokens.begin() + first);
+
+    return {first, removed, fresh.size()};
+}
+
+
+// =====================================================================================================================
+// Parallel lexing
+// =====================================================================================================================
+// Run f(i) for every i in [0, count) on up to jobs threads
+template <class F>
+void parallel_for (size_t count, int jobs, F&& f)
+{
+    atomic<size_t> next {0};
+
+    auto work = [&]
+    {
+        for (size_t i; (i = next++) < count;)    f(i);
+    };
+
+    vector<thread> threads;
+
+    for (size_t t = 1; t < min<size_t>(jobs, count); ++t)    threads.emplace_back(work);
+
+    work();
+
+    for (auto& t : threads)    t.join();
+}
+
+
+// The output for the tokens lexed from one start state until the Lexer passes limit, with where the Scanner stood and
+// how much output there was after each of them. Every position the Lexer comes to rest at between tokens is a point at
+// which another run that reaches the same position (and so the same line and column) can pick up this one's output.
+// Runs are reused from wave to wave, so their storage is only allocated once.
+struct ChunkRun
+{
+    const char*         start = nullptr;
+    OutputBuffer        text;
+    vector<size_t>      marks;
+    vector<const char*> ends;
+    Scanner             state {nullptr};    // after the last token
+    exception_ptr       error;              // what cut the run short, if anything
+
+    template <class Emit>
+    void run (Scanner from, const char* limit, Emit& emit)
+    {
+        start = from.pos;
+        state = from;
+        error = nullptr;
+        text.clear();
+        marks.clear();
+        ends.clear();
+
+        extend(limit, emit);
+    }
+
+    void clear ()    { start = nullptr; }
+
+    explicit operator bool () const    { return start != nullptr; }
+
+    // Lex on from state until the Lexer passes limit, or until stop(position) says to. Should lexing or emitting a
+    // token throw, the run stops before that token and keeps the exception, to be raised only if the run is stitched
+    // in.
+    template <class Emit, class Stop = bool (*) (const char*)>
+    void extend (const char* limit, Emit& emit, Stop&& stop = [](const char*) { return false; })
+    {
+        Lexer lexer {state};
+
+        try
+        {
+            while (lexer.state().pos < limit && lexer.has_more())
+            {
+                emit(text, lexer.next_span());
+                marks.push_back(text.size());
+                ends.push_back(lexer.state().pos);
+
+                state = lexer.state();
+                if (stop(state.pos))    break;
+            }
+        }
+        catch (...)
+        {
+            text.truncate(marks.empty() ? 0 : marks.back());
+            error = current_exception();
+        }
+    }
+
+    // Index of the token a Lexer standing at p would produce next, if p is one of this run's resting points
+    optional<size_t> resume (const char* p) const
+    {
+        if (p == start)    return 0;
+
+        auto i = lower_bound(ends.begin(), ends.end(), p);
+        if (i != ends.end() && *i == p)    return i - ends.begin() + 1;
+
+        return nullopt;
+    }
+
+    // The output from token i on
+    string_view output (size_t i) const
+    {
+        size_t from = (i == 0) ? 0 : marks[i - 1];
+        return {text.data() + from, text.size() - from};
+    }
+}; // struct ChunkRun
+
+
+// Where a chunk's first line would leave the Lexer if it started inside a block comment: just past the comment's
+// closing characters, found by comment_end() as the Lexer finds them. nullopt if the comment doesn't close before
+// limit, so that a comment spanning many chunks is scanned once per chunk rather than to its end from each.
+optional<Scanner> after_comment (const char* line_start, const char* limit, int line)
+{
+    auto [end, closed] = comment_end(line_start, limit);
+    if (!closed)    return nullopt;
+
+    Scanner s {line_start};
+    s.line = line;
+    s.advance_to(end);
+
+    return s;
+}
+
+
+// Lex input on up to jobs threads, giving the same tokens in the same order as lex_buffer, and append emit(buffer,
+// token) for each of them to out. A chunk_size of 0 means 64 KiB, which keeps a wave's output in cache.
+//
+// The input is cut into chunks at line starts and processed a wave of jobs chunks at a time. A prefix sum of newline
+// counts gives the line each chunk starts on, so every chunk is lexed with true positions from the start. Each chunk is
+// lexed speculatively as if it began in ordinary code, and, should that run not come to rest just past the chunk's
+// first block comment close, also as if it began inside a comment. Tokens are formatted as they are lexed, on the same
+// thread. The runs are then stitched in order: the previous chunk's last token ends at some position, and the chunk
+// continues from whichever of its runs came to rest there. In the rare case neither did, the chunk is re-lexed from
+// that position until it falls into step with its ordinary run.
+template <class Out, class Emit>
+void lex_parallel (string_view input, int jobs, size_t chunk_size, Out& out, Emit&& emit)
+{
+    // Lexing stops at the first '\0', wherever it is
+    const char* begin = input.data();
+    const char* end   = static_cast<const char*>(memchr(begin, '\0', input.size()));
+    if (!end)    end = begin + input.size();
+
+    if (chunk_size == 0)    chunk_size = 64 * 1024;
+
+    vector<const char*> bounds {begin};
+
+    while (end - bounds.back() > ptrdiff_t(chunk_size))
+    {
+        const char* from    = bounds.back() + chunk_size;
+        auto        newline = static_cast<const char*>(memchr(from, '\n', end - from));
+        if (!newline || newline + 1 == end)    break;
+
+        bounds.push_back(newline + 1);
+    }
+
+    bounds.push_back(end);
+
+    size_t chunks = bounds.size() - 1;
+
+    // Line counts are summed a wave ahead of lexing it, so the first output needn't wait on a pass over the whole input
+    vector<int> lines (chunks + 1, 1);
+
+    Scanner carried {begin};    // where the last token stitched in left the Lexer
+
+    vector<ChunkRun> code    (min<size_t>(jobs, chunks));
+    vector<ChunkRun> comment (code.size());
+    ChunkRun         relexed;
+
+    for (size_t wave = 0; wave < chunks; wave += jobs)
+    {
+        size_t count = min<size_t>(jobs, chunks - wave);
+
+        parallel_for(count, jobs, [&](size_t k)
+        {
+            size_t i = wave + k;
+            lines[i + 1] = count_newlines(bounds[i], bounds[i + 1] - bounds[i]);
+        });
+
+        partial_sum(lines.begin() + wave, lines.begin() + wave + count + 1, lines.begin() + wave);
+
+        parallel_for(count, jobs, [&](size_t k)
+        {
+            size_t i = wave + k;
+
+            // A token from an earlier wave, such as a long block comment, may already have covered the chunk
+            if (carried.pos >= bounds[i + 1])    return;
+
+            Scanner start {bounds[i]};
+            start.line = lines[i];
+
+            code[k].run(start, bounds[i + 1], emit);
+            comment[k].clear();
+
+            if (i == 0)    return;
+
+            // The ordinary run is usually a comment's own, in which case it comes to rest after the token that follows
+            auto closed = after_comment(bounds[i], bounds[i + 1], lines[i]);
+            if (!closed || closed->pos >= bounds[i + 1] || code[k].resume(closed->pos))    return;
+
+            Lexer next {*closed};
+            if (next.has_more())    next.next_compact();
+
+            if (!code[k].resume(next.state().pos))    comment[k].run(*closed, bounds[i + 1], emit);
+        });
+
+        // Stitch the chunks' output together in order
+        for (size_t k = 0; k < count; ++k)
+        {
+            size_t i = wave + k;
+
+            if (carried.pos >= bounds[i + 1])    continue;
+
+            ChunkRun* run = &code[k];
+            auto      at  = run->resume(carried.pos);
+
+            if (!at && comment[k])    at = (run = &comment[k])->resume(carried.pos);
+
+            if (!at)
+            {
+                // Lex on from where the last chunk left off until coming to rest where the ordinary run did
+                relexed.run(carried, carried.pos, emit);
+                relexed.extend(bounds[i + 1], emit, [&](const char* p) { return code[k].resume(p).has_value(); });
+
+                if (relexed.error)    rethrow_exception(relexed.error);
+
+                out.append(relexed.output(0));
+                carried = relexed.state;
+
+                run = &code[k];
+                if (!(at = run->resume(carried.pos)))    continue;
+            }
+
+            out.append(run->output(*at));
+            carried = run->state;
+
+            // A run cut short is lexed on here, where what stopped it is an error in earnest
+            if (run->error)
+            {
+                relexed.run(carried, bounds[i + 1], emit);
+                if (relexed.error)    rethrow_exception(relexed.error);
+
+                out.append(relexed.output(0));
+                carried = relexed.state;
+            }
+        }
+    }
 }
+
+
+struct IOOptions
+{
+    MappedFile::Options map;
+    int                 jobs       = 1;
+    size_t              chunk_size = 0;    // for lex_parallel
+};
+
+
+// How far a single-threaded pass over a mapped file gets between releasing the pages behind it
+constexpr ptrdiff_t release_step = 1 << 20;
+
+
+// Append emit(out, token) to out for every token read from fd: mapped and lexed in place when fd is a regular file,
+// across options.jobs threads if there is more than one, and streamed otherwise.
+template <class Out, class Emit>
+void lex_fd (int fd, const IOOptions& options, Out& out, Emit&& emit)
+{
+    if (MappedFile::can_map(fd))
+    {
+        MappedFile input {fd, options.map};
+
+        if (options.jobs > 1)    lex_parallel(input.view(), options.jobs, options.chunk_size, out, emit);
+        else
+        {
+            // Once a token is emitted nothing refers to the input before it
+            const char* release_at = input.view().data();
+
+            lex_buffer(input.view(), [&](const TokenSpan& token)
+            {
+                emit(out, token);
+
+                if (token.text.data() >= release_at)
+                {
+                    input.release(token.text.data());
+                    release_at = token.text.data() + release_step;
+                }
+            });
+        }
+    }
+    else
+    {
+        lex_stream(fd, [&](const TokenSpan& token) { emit(out, token); }, [&] { out.flush(); });
+    }
+}
+
+
+int open_input (const string& source)
+{
+    int fd = (source == "stdin") ? STDIN_FILENO : open(source.c_str(), O_RDONLY);
+    if (fd < 0)    throw (errno);
+
+    return fd;
+}
+
+
+// Open the destination for writing, once the source is open as in. Truncating the source would lose the input before
+// it is read, so a destination that is the same file is refused. Errors name the destination, as they aren't the
+// source's.
+int open_output (const string& destination, int in)
+{
+    if (destination == "stdout")    return STDOUT_FILENO;
+
+    struct stat source, target;
+
+    if (fstat(in, &source) == 0 && stat(destination.c_str(), &target) == 0
+        && source.st_dev == target.st_dev && source.st_ino == target.st_ino)
+        throw runtime_error(destination + ": would overwrite the input");
+
+    int fd = open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)    throw runtime_error(destination + ": " + strerror(errno));
+
+    return fd;
+}
+
+
+void close_IO (int in, int out)
+{
+    if (in  != STDIN_FILENO)     close(in);
+    if (out != STDOUT_FILENO)    close(out);
+}
+
+
+// Calls f(lex, out), where out is the OutputSink for the destination and lex(emit) appends emit(out, token) to it for
+// every token of the source. With more than one job, emit also runs on worker threads, writing to an OutputBuffer
+// that is then appended to out in order.
+template <class F>
+void with_IO (string source, string destination, const IOOptions& options, F&& f)
+{
+    int fd     = open_input(source);
+    int out_fd = open_output(destination, fd);
+
+    OutputSink out {out_fd};
+
+    f([&](auto&& emit) { lex_fd(fd, options, out, emit); }, out);
+
+    out.flush();
+    close_IO(fd, out_fd);
+}
+
+
+// Calls f(tokens, out), where tokens reads the binary token stream in the source and out is the OutputSink for the
+// destination
+template <class F>
+void decode_IO (string source, string destination, F&& f)
+{
+    int fd     = open_input(source);
+    int out_fd = open_output(destination, fd);
+
+    OutputSink out {out_fd};
+
+    if (MappedFile::can_map(fd))
+    {
+        MappedFile input {fd, {}};
+        f(TokenStreamReader {input.view()}, out);
+    }
+    else
+    {
+        string input;
+        char   block[64 * 1024];
+
+        for (ssize_t n; (n = read(fd, block, sizeof block)) != 0;)
+        {
+            if (n < 0 && errno == EINTR)    continue;
+            if (n < 0)                      throw (errno);
+
+            input.append(block, n);
+        }
+
+        f(TokenStreamReader {input}, out);
+    }
+
+    out.flush();
+    close_IO(fd, out_fd);
+}
+
+
+// =====================================================================================================================
+// Batch mode
+// =====================================================================================================================
+// Run f(i) for every i in [0, count) on up to jobs threads, starting tasks roughly in index order. Each worker owns a
+// deque of tasks, dealt out round-robin, and takes from the front of its own; a worker that runs dry steals from the
+// back of the others'. No tasks are added once running, so a worker that finds every deque empty is done.
+template <class F>
+void work_stealing_for (size_t count, int jobs, F&& f)
+{
+    struct Deque
+    {
+        mutex         lock;
+        deque<size_t> tasks;
+    };
+
+    size_t        workers = max<size_t>(min<size_t>(jobs, count), 1);
+    vector<Deque> deques (workers);
+
+    for (size_t i = 0; i < count; ++i)    deques[i % workers].tasks.push_back(i);
+
+    auto work = [&](size_t self)
+    {
+        while (true)
+        {
+            optional<size_t> task;
+
+            {
+                lock_guard<mutex> guard {deques[self].lock};
+
+                if (!deques[self].tasks.empty())
+                {
+                    task = deques[self].tasks.front();
+                    deques[self].tasks.pop_front();
+                }
+            }
+
+            for (size_t v = 1; !task && v < workers; ++v)
+            {
+                Deque& victim = deques[(self + v) % workers];
+                lock_guard<mutex> guard {victim.lock};
+
+                if (!victim.tasks.empty())
+                {
+                    task = victim.tasks.back();
+                    victim.tasks.pop_back();
+                }
+            }
+
+            if (!task)    return;
+
+            f(*task);
+        }
+    };
+
+    vector<thread> threads;
+
+    for (size_t t = 1; t < workers; ++t)    threads.emplace_back(work, t);
+
+    work(0);
+
+    for (auto& t : threads)    t.join();
+}
+
+
+// The files named by a list of paths, directories and glob patterns, sorted and without duplicates. Directories are
+// searched recursively for files with the extension .t.
+vector<string> expand_paths (const vector<string>& args)
+{
+    vector<string> found;
+
+    auto add = [&](const string& path)
+    {
+        if (!filesystem::is_directory(path))    return found.push_back(path);
+
+        for (auto& entry : filesystem::recursive_directory_iterator {path})
+            if (entry.is_regular_file() && entry.path().extension() == ".t")    found.push_back(entry.path());
+    };
+
+    for (auto& arg : args)
+    {
+        if (arg.find_first_of("*?[") == string::npos)    { add(arg); continue; }
+
+        glob_t matches;
+        if (glob(arg.c_str(), 0, nullptr, &matches) != 0)    throw invalid_argument("no files match " + arg);
+
+        for (size_t i = 0; i < matches.gl_pathc; ++i)    add(matches.gl_pathv[i]);
+
+        globfree(&matches);
+    }
+
+    sort(found.begin(), found.end());
+    found.erase(unique(found.begin(), found.end()), found.end());
+
+    return found;
+}
+
+
+struct BatchOptions
+{
+    IOOptions io;                   // io.jobs is the number of files lexed at once
+    string    out_dir;              // write each file's output to out_dir/<path>.lex, rather than all of it to out
+};
+
+
+// Closes the file descriptor it is given when it goes out of scope. A negative descriptor is thrown as errno.
+class FileDescriptor
+{
+public:
+    explicit FileDescriptor (int fd) : fd {fd}    { if (fd < 0)    throw (errno); }
+
+    FileDescriptor (const FileDescriptor&) = delete;
+    FileDescriptor& operator= (const FileDescriptor&) = delete;
+
+    ~FileDescriptor ()    { close(fd); }
+
+    operator int () const    { return fd; }
+
+private:
+    int fd;
+}; // class FileDescriptor
+
+
+// Where under dir the output for path goes: path.lex, made relative and with any ".." left after normalising dropped,
+// so that it always lands inside dir
+filesystem::path output_path (const string& dir, const string& path)
+{
+    filesystem::path inside;
+
+    for (auto& part : filesystem::path {path + ".lex"}.lexically_normal().relative_path())
+        if (part != "..")    inside /= part;
+
+    return filesystem::path {dir} / inside;
+}
+
+
+struct BatchStats
+{
+    size_t files  = 0;
+    size_t failed = 0;
+    size_t bytes  = 0;
+    size_t tokens = 0;
+};
+
+
+// Lex many files at once on a work-stealing pool, largest files first. Each file's output is emit(out, token) for
+// every one of its tokens, written either to its own file under options.out_dir or, in path order, to out behind a
+// "==> path <==" line. begin(out, path) writes anything that goes before a file's tokens.
+template <class Out, class Begin, class Emit>
+BatchStats lex_batch (const vector<string>& paths, const BatchOptions& options, Out& out, Begin&& begin, Emit&& emit)
+{
+    vector<size_t> sizes (paths.size());
+    vector<size_t> order (paths.size());
+
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        error_code error;
+        sizes[i] = filesystem::file_size(paths[i], error);
+        order[i] = i;
+    }
+
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    // Different paths can map to the same output file, such as x.t and ../x.t. The first path to claim an output owns
+    // it, and the others fail rather than overwrite it.
+    vector<filesystem::path> destinations;
+    vector<size_t>           owner (paths.size());
+
+    if (!options.out_dir.empty())
+    {
+        unordered_map<string, size_t> claimed;
+
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            destinations.push_back(output_path(options.out_dir, paths[i]));
+            owner[i] = claimed.try_emplace(destinations[i].string(), i).first->second;
+        }
+    }
+
+    // Combined output is held back until every file before it has been written
+    vector<OutputBuffer> held  (options.out_dir.empty() ? paths.size() : 0);
+    vector<char>         done  (held.size());
+    size_t               next  = 0;
+    mutex                order_lock;
+
+    atomic<size_t> failed {0}, bytes {0}, tokens {0};
+
+    auto counted = [&](size_t& count)
+    {
+        return [&emit, &count](auto& out, const TokenSpan& token) { ++count; emit(out, token); };
+    };
+
+    work_stealing_for(paths.size(), options.io.jobs, [&](size_t task)
+    {
+        size_t        i     = order[task];
+        const string& path  = paths[i];
+        size_t        count = 0;
+
+        try
+        {
+            FileDescriptor fd {open(path.c_str(), O_RDONLY)};
+
+            IOOptions single = options.io;
+            single.jobs = 1;
+
+            if (options.out_dir.empty())
+            {
+                held[i].append("==> " + path + " <==\n");
+                begin(held[i], path);
+                lex_fd(fd, single, held[i], counted(count));
+            }
+            else
+            {
+                const auto& destination = destinations[i];
+
+                if (owner[i] != i)
+                    throw runtime_error("output " + destination.string() + " is already " + paths[owner[i]] + "'s");
+
+                filesystem::create_directories(destination.parent_path());
+
+                FileDescriptor out_fd {open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666)};
+
+                OutputSink file_out {out_fd};
+                begin(file_out, path);
+                lex_fd(fd, single, file_out, counted(count));
+                file_out.flush();
+            }
+
+            bytes  += sizes[i];
+            tokens += count;
+        }
+        catch (int error)
+        {
+            cerr << "lex: " << path << ": " << strerror(error) << '\n';
+            ++failed;
+        }
+        catch (const exception& e)
+        {
+            cerr << "lex: " << path << ": " << e.what() << '\n';
+            ++failed;
+        }
+
+        if (options.out_dir.empty())
+        {
+            lock_guard<mutex> guard {order_lock};
+
+            done[i] = true;
+
+            for (; next < held.size() && done[next]; ++next)
+            {
+                out.append(held[next].data(), held[next].size());
+                held[next] = {};
+            }
+        }
+    });
+
+    return {paths.size(), failed, bytes, tokens};
+}
+
+
+#ifndef LEX_NO_MAIN    // defined by the benchmarks, which include this file for its lexer
+
+// =====================================================================================================================
+// Command line
+// =====================================================================================================================
+struct Options
+{
+    vector<string> inputs;
+    string         output = "stdout";
+    BatchOptions   batch;
+    bool           batch_mode = false;
+    bool           report     = false;
+    bool           binary     = false;
+    bool           decode     = false;
+};
+
+
+const char* usage =
+    "usage: lex [options] [input [output]]\n"
+    "       lex --batch [options] path...\n"
+    "\n"
+    "  -j, --jobs N          lex a file on N threads (default: 1),\n"
+    "                        or in batch mode N files at once (default: one per CPU)\n"
+    "  --chunk-size BYTES    split a file into chunks of about BYTES for -j (default: 64 KiB)\n"
+    "  --populate            prefault the whole input mapping (MAP_POPULATE)\n"
+    "  --sequential          advise the kernel the input is read front to back (MADV_SEQUENTIAL)\n"
+    "  --binary              write a binary token stream rather than text (lexes on one thread)\n"
+    "  --decode              read a binary token stream and write it out as text\n"
+    "\n"
+    "  --batch               lex every file named, found under a directory (*.t) or matched by a glob\n"
+    "  -o, --out-dir DIR     in batch mode, write each file's output to DIR/<path>.lex rather than all to stdout\n"
+    "  --report              in batch mode, report throughput on stderr\n";
+
+
+Options parse_args (int argc, char* argv[])
+{
+    Options options;
+    options.batch.io.jobs = 0;
+
+    // The value following option i
+    auto value = [&](int& i)
+    {
+        if (++i == argc)    throw invalid_argument("missing value for " + string(argv[i - 1]));
+        return string(argv[i]);
+    };
+
+    // The value following option i as a number, which must be at least min
+    auto number = [&](int& i, long min)
+    {
+        string option = argv[i];
+        string text   = value(i);
+
+        char* end;
+        long  n = strtol(text.c_str(), &end, 10);
+        if (*end != '\0' || n < min)    throw invalid_argument("invalid value for " + option + ": " + text);
+
+        return n;
+    };
+
+    IOOptions& io = options.batch.io;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string_view arg = argv[i];
+
+        if      (arg == "-j" || arg == "--jobs")       io.jobs               = number(i, 1);
+        else if (arg == "--chunk-size")                io.chunk_size         = number(i, 1);
+        else if (arg == "--populate")                  io.map.populate       = true;
+        else if (arg == "--sequential")                io.map.sequential     = true;
+        else if (arg == "--batch")                     options.batch_mode    = true;
+        else if (arg == "-o" || arg == "--out-dir")    options.batch.out_dir = value(i);
+        else if (arg == "--report")                    options.report        = true;
+        else if (arg == "--binary")                    options.binary        = true;
+        else if (arg == "--decode")                    options.decode        = true;
+        else if (arg.size() > 2 && arg.substr(0, 2) == "--")    throw invalid_argument("unknown option " + string(arg));
+        else                                           options.inputs.emplace_back(arg);
+    }
+
+    if (options.binary && options.decode)    throw invalid_argument("--binary and --decode don't go together");
+
+    if (options.batch_mode)
+    {
+        if (options.inputs.empty())                 throw invalid_argument("no inputs");
+        if (options.binary || options.decode)       throw invalid_argument("--batch writes text only");
+        if (io.jobs == 0)                           io.jobs = max(thread::hardware_concurrency(), 1u);
+    }
+    else
+    {
+        if (options.inputs.size() > 2)            throw invalid_argument("too many arguments");
+        if (!options.batch.out_dir.empty())       throw invalid_argument("-o/--out-dir is for --batch only");
+        if (options.inputs.size() == 2)
+        {
+            options.output = options.inputs.back();
+            options.inputs.pop_back();
+        }
+
+        if (options.inputs.empty())    options.inputs.push_back("stdin");
+        if (io.jobs == 0)              io.jobs = 1;
+    }
+
+    return options;
+}
+
+
+int main (int argc, char* argv[])
+{
+    Options options;
+
+    try
+    {
+        options = parse_args(argc, argv);
+    }
+    catch (const invalid_argument& e)
+    {
+        cerr << "lex: " << e.what() << "\n\n" << usage;
+        return 1;
+    }
+
+    const string_view header = "Location  Token name        Value\n"
+                               "--------------------------------------\n";
+
+    auto format = [](auto& out, const TokenSpan& token) { TextSink {out}(token); };
+
+    if (!options.batch_mode)
+    {
+        try
+        {
+            if (options.binary)
+            {
+                options.batch.io.jobs = 1;
+
+                with_IO(options.inputs.front(), options.output, options.batch.io, [](auto&& lex, OutputSink& out)
+                {
+                    TokenStreamWriter writer;
+
+                    lex([&](auto&, const Token& token) { writer.add(token); });
+                    writer.write(out);
+                });
+            }
+            else if (options.decode)
+            {
+                decode_IO(options.inputs.front(), options.output, [&](const TokenStreamReader& tokens, OutputSink& out)
+                {
+                    out.append(header);
+                    for (auto& record : tokens)    write_token(out, to_token(record));
+                });
+            }
+            else
+            {
+                with_IO(options.inputs.front(), options.output, options.batch.io, [&](auto&& lex, OutputSink& out)
+                {
+                    out.append(header);
+                    lex(format);
+                });
+            }
+        }
+        catch (int error)
+        {
+            cerr << "lex: " << options.inputs.front() << ": " << strerror(error) << '\n';
+            return 1;
+        }
+        catch (const exception& e)
+        {
+            cerr << "lex: " << e.what() << '\n';
+            return 1;
+        }
+
+        return 0;
+    }
+
+    vector<string> paths;
+
+    try
+    {
+        paths = expand_paths(options.inputs);
+    }
+    catch (const exception& e)
+    {
+        cerr << "lex: " << e.what() << '\n';
+        return 1;
+    }
+
+    OutputSink out {STDOUT_FILENO};
+
+    auto start = chrono::steady_clock::now();
+    auto stats = lex_batch(paths, options.batch, out, [&](auto& out, const string&) { out.append(header); }, format);
+
+    out.flush();
+
+    if (options.report)
+    {
+        double seconds = chrono::duration<double> {chrono::steady_clock::now() - start}.count();
+
+        cerr << "lex: " << stats.files << " files (" << stats.failed << " failed), " << stats.bytes << " bytes, "
+             << stats.tokens << " tokens in " << fixed << setprecision(3) << seconds << " s on "
+             << options.batch.io.jobs << " threads: " << setprecision(1) << stats.bytes / seconds / 1e6 << " MB/s, "
+             << stats.tokens / seconds / 1e6 << " M tokens/s\n";
+    }
+
+    return stats.failed ? 1 : 0;
+}
+
+#endif // LEX_NO_MAIN
@@ -0,0 +1,20 @@
+/* a comment
+   spanning "lines with ' quotes
+   and * stars ** and / slashes /* nested
+*/ x = 1;
+/**/ y /***/ = 2; /* ok */
+/*
+ " unterminated string inside
+ */ print("a\nb");
+z = 'a' + '\\';
+/* tail */
+w = 3; /* close
+**/ q
+*/ r
+/* last
+*/
+x = 1;
+/* start
+   '\*/* y = 2;
+   more */ z = 3;
+w = 4;
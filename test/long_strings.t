@@ -0,0 +1,122 @@
+/* String literals long enough to take the vectorised escape scan, with escapes at every offset */
+print("\\");
+print("\ncgY");
+print("c\ngY");
+print("cg\nY");
+print("cgY\\");
+print("\nXa9 da");
+print("X\\a9 da");
+print("Xa\\9 da");
+print("Xa9\n da");
+print("Xa9 \nda");
+print("Xa9 d\na");
+print("Xa9 da\\");
+print("\\a1XbdYYXa");
+print("a1\nXbdYYXa");
+print("a1Xb\ndYYXa");
+print("a1XbdY\nYXa");
+print("a1XbdYYX\na");
+print("\negc bXe 1Ycb");
+print("egc\\ bXe 1Ycb");
+print("egc bX\ne 1Ycb");
+print("egc bXe 1\nYcb");
+print("egc bXe 1Ycb\n");
+print("\nXdhY g0fhX9hfed");
+print("Xdh\nY g0fhX9hfed");
+print("XdhY g\n0fhX9hfed");
+print("XdhY g0fh\\X9hfed");
+print("XdhY g0fhX9h\\fed");
+print("XdhY g0fhX9hfed\\");
+print("\\ZheXbb gc0fc9hgaYb");
+print("ZheX\\bb gc0fc9hgaYb");
+print("ZheXbb g\\c0fc9hgaYb");
+print("ZheXbb gc0fc\\9hgaYb");
+print("ZheXbb gc0fc9hga\\Yb");
+print("\\b1behZYbaZZeYXY1heZg9");
+print("b1beh\nZYbaZZeYXY1heZg9");
+print("b1behZYbaZ\\ZeYXY1heZg9");
+print("b1behZYbaZZeYXY\\1heZg9");
+print("b1behZYbaZZeYXY1heZg\n9");
+print("\\Xbhad0ecZdgg91hbchg e9c1");
+print("Xbhad0\\ecZdgg91hbchg e9c1");
+print("Xbhad0ecZdgg\\91hbchg e9c1");
+print("Xbhad0ecZdgg91hbch\\g e9c1");
+print("Xbhad0ecZdgg91hbchg e9c1\\");
+print("\ndcbccdYdah1Xceeacg fXXfcZ1 ");
+print("dcbccd\\Ydah1Xceeacg fXXfcZ1 ");
+print("dcbccdYdah1X\\ceeacg fXXfcZ1 ");
+print("dcbccdYdah1Xceeacg\\ fXXfcZ1 ");
+print("dcbccdYdah1Xceeacg fXXfc\\Z1 ");
+print("\\gbhYgadbdhcbfXabaXc bfXab1dXgc");
+print("gbhYgad\\bdhcbfXabaXc bfXab1dXgc");
+print("gbhYgadbdhcbfX\\abaXc bfXab1dXgc");
+print("gbhYgadbdhcbfXabaXc b\\fXab1dXgc");
+print("gbhYgadbdhcbfXabaXc bfXab1dX\ngc");
+print("\nb1hhhhebcbZfZeh1Zc ad fcZ 9a0 eY1");
+print("b1hhhheb\\cbZfZeh1Zc ad fcZ 9a0 eY1");
+print("b1hhhhebcbZfZeh1\\Zc ad fcZ 9a0 eY1");
+print("b1hhhhebcbZfZeh1Zc ad fc\nZ 9a0 eY1");
+print("b1hhhhebcbZfZeh1Zc ad fcZ 9a0 eY\\1");
+print("\\0d  0 fYdX0001d0d1gZ0dd hfZaa0ehedZX");
+print("0d  0 fYd\\X0001d0d1gZ0dd hfZaa0ehedZX");
+print("0d  0 fYdX0001d0d1\\gZ0dd hfZaa0ehedZX");
+print("0d  0 fYdX0001d0d1gZ0dd hfZ\\aa0ehedZX");
+print("0d  0 fYdX0001d0d1gZ0dd hfZaa0ehedZX\n");
+print("\\dbdhdfdhX9X1ah9Yf0Yb1Yb9g0Z0dh9cg0Yfb0Z");
+print("dbdhdfdhX\\9X1ah9Yf0Yb1Yb9g0Z0dh9cg0Yfb0Z");
+print("dbdhdfdhX9X1ah9Yf0\\Yb1Yb9g0Z0dh9cg0Yfb0Z");
+print("dbdhdfdhX9X1ah9Yf0Yb1Yb9g0Z\n0dh9cg0Yfb0Z");
+print("dbdhdfdhX9X1ah9Yf0Yb1Yb9g0Z0dh9cg0Yf\nb0Z");
+print("\nccacX9h0YcX1XhY9fc  caa0ZYb Z9cg1d11daede ");
+print("ccacX9h0Yc\\X1XhY9fc  caa0ZYb Z9cg1d11daede ");
+print("ccacX9h0YcX1XhY9fc  \\caa0ZYb Z9cg1d11daede ");
+print("ccacX9h0YcX1XhY9fc  caa0ZYb Z9\\cg1d11daede ");
+print("ccacX9h0YcX1XhY9fc  caa0ZYb Z9cg1d11daed\ne ");
+print("\na9Zf9hYX19 g199 c c  a1h0cXa00ccchXZb afY   h");
+print("a9Zf9hYX19 \ng199 c c  a1h0cXa00ccchXZb afY   h");
+print("a9Zf9hYX19 g199 c c  a\n1h0cXa00ccchXZb afY   h");
+print("a9Zf9hYX19 g199 c c  a1h0cXa00ccc\nhXZb afY   h");
+print("a9Zf9hYX19 g199 c c  a1h0cXa00ccchXZb afY   \\h");
+print("\\a0b h a099bhfX X dZeh  0h dZ 999e9 9d1hcgbghfbYd");
+print("a0b h a099bh\nfX X dZeh  0h dZ 999e9 9d1hcgbghfbYd");
+print("a0b h a099bhfX X dZeh  0\nh dZ 999e9 9d1hcgbghfbYd");
+print("a0b h a099bhfX X dZeh  0h dZ 999e9 9\\d1hcgbghfbYd");
+print("a0b h a099bhfX X dZeh  0h dZ 999e9 9d1hcgbghfbYd\n");
+print("\n90cZYYfce9chdZbg9hcY1dcZg gfgdffbZfaf hhZagf Xe bb9");
+print("90cZYYfce9ch\ndZbg9hcY1dcZg gfgdffbZfaf hhZagf Xe bb9");
+print("90cZYYfce9chdZbg9hcY1dcZ\ng gfgdffbZfaf hhZagf Xe bb9");
+print("90cZYYfce9chdZbg9hcY1dcZg gfgdffbZfa\\f hhZagf Xe bb9");
+print("90cZYYfce9chdZbg9hcY1dcZg gfgdffbZfaf hhZagf Xe \\bb9");
+print("\na90ce0c1g19Y1egc 9 XhZfbea0Zcg9beaYb0ebX1dbe1bhaf g99e");
+print("a90ce0c1g19Y1\negc 9 XhZfbea0Zcg9beaYb0ebX1dbe1bhaf g99e");
+print("a90ce0c1g19Y1egc 9 XhZfbea\n0Zcg9beaYb0ebX1dbe1bhaf g99e");
+print("a90ce0c1g19Y1egc 9 XhZfbea0Zcg9beaYb0eb\nX1dbe1bhaf g99e");
+print("a90ce0c1g19Y1egc 9 XhZfbea0Zcg9beaYb0ebX1dbe1bhaf g9\n9e");
+print("\\eacd9eYe 0deh Ycef0aeaaaZ  d hd9hbY1YgYh 19g eZddfd19ZZYc");
+print("eacd9eYe 0deh \\Ycef0aeaaaZ  d hd9hbY1YgYh 19g eZddfd19ZZYc");
+print("eacd9eYe 0deh Ycef0aeaaaZ  d\n hd9hbY1YgYh 19g eZddfd19ZZYc");
+print("eacd9eYe 0deh Ycef0aeaaaZ  d hd9hbY1YgYh 1\n9g eZddfd19ZZYc");
+print("eacd9eYe 0deh Ycef0aeaaaZ  d hd9hbY1YgYh 19g eZddfd19ZZY\nc");
+print("\\bYZ9egcabY1g1 YeXdZeahccehaeff fda9edfcafgbhe Ydd 0abe1bcgXa");
+print("bYZ9egcabY1g1 Y\neXdZeahccehaeff fda9edfcafgbhe Ydd 0abe1bcgXa");
+print("bYZ9egcabY1g1 YeXdZeahccehaeff\\ fda9edfcafgbhe Ydd 0abe1bcgXa");
+print("bYZ9egcabY1g1 YeXdZeahccehaeff fda9edfcafgbhe\\ Ydd 0abe1bcgXa");
+print("bYZ9egcabY1g1 YeXdZeahccehaeff fda9edfcafgbhe Ydd 0abe1bcgXa\n");
+print("\\bX 10cY9Z09Xg0fZhceZXYca11Z9 YgZZ0 c9 0 X110a1YX09ZYZYdbaacYfbg");
+print("bX 10cY9Z09Xg0f\nZhceZXYca11Z9 YgZZ0 c9 0 X110a1YX09ZYZYdbaacYfbg");
+print("bX 10cY9Z09Xg0fZhceZXYca11Z9 Y\ngZZ0 c9 0 X110a1YX09ZYZYdbaacYfbg");
+print("bX 10cY9Z09Xg0fZhceZXYca11Z9 YgZZ0 c9 0 X110a\n1YX09ZYZYdbaacYfbg");
+print("bX 10cY9Z09Xg0fZhceZXYca11Z9 YgZZ0 c9 0 X110a1YX09ZYZYdbaacY\\fbg");
+print("\\eah0bZ9 9 bY bZZhe0b1edZ0ddZYhh1gbh9Ye0aXYYdbXcfeYZZeXXcahaheYbZdY");
+print("eah0bZ9 9 bY bZZ\\he0b1edZ0ddZYhh1gbh9Ye0aXYYdbXcfeYZZeXXcahaheYbZdY");
+print("eah0bZ9 9 bY bZZhe0b1edZ0ddZYhh1\\gbh9Ye0aXYYdbXcfeYZZeXXcahaheYbZdY");
+print("eah0bZ9 9 bY bZZhe0b1edZ0ddZYhh1gbh9Ye0aXYYdbXcf\\eYZZeXXcahaheYbZdY");
+print("eah0bZ9 9 bY bZZhe0b1edZ0ddZYhh1gbh9Ye0aXYYdbXcfeYZZeXXcahaheYbZ\\dY");
+print("\\h0b9 deb9haehb1 hegd99dbXbcZ efcX1Y e9bZfdh99hgacahYhgeZcgfgfb1faf0f1");
+print("h0b9 deb9haehb1 h\negd99dbXbcZ efcX1Y e9bZfdh99hgacahYhgeZcgfgfb1faf0f1");
+print("h0b9 deb9haehb1 hegd99dbXbcZ efcX1\nY e9bZfdh99hgacahYhgeZcgfgfb1faf0f1");
+print("h0b9 deb9haehb1 hegd99dbXbcZ efcX1Y e9bZfdh99hgacah\nYhgeZcgfgfb1faf0f1");
+print("h0b9 deb9haehb1 hegd99dbXbcZ efcX1Y e9bZfdh99hgacahYhgeZcgfgfb1faf0f\\1");
+s = "\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n";
+s = "\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\";
+s = "abab\nc c  \nabc ab\nab\n\nab\\\\abc  ab\\abc \nc   \\\n\nc c  \\abc \n \\\\c c abababababc \\abc  c \n\\\\\n\\ c  \\c abc c \\ \\\\\n\\ab \nab\\abab \\\nc c c  \\c abab\nc ab ab\\  \\\nab\\c c c c ab\n\\\nc c  c \n\nc  c c \\\n\\\\\\ \nc \n \n\n\\\\ \nab\\ab c \n\n\nab  \\c ab\\ \n\n abc abab\\c  \\ \\\nc ab\n\n\\c c \nab\\c ab\\c \nabc abc \\\nab \n\\c \\ab\\\\c \\ab";
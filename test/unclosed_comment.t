@@ -0,0 +1,3 @@
+/* An unclosed comment, with the start of another inside it
+aaaa /* more
+x